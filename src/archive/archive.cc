@@ -5,10 +5,12 @@
 #include <fstream>
 #include <giomm.h>
 #include <glib.h>
+#include <glib/gstdio.h>
 #include <utility>
 using namespace AhoViewer;
 
 #include "config.h"
+#include "extensionset.h"
 #include "tempdir.h"
 #ifdef HAVE_LIBUNRAR
 #include "rar.h"
@@ -46,14 +48,8 @@ bool Archive::is_valid(const std::string& path)
 
 bool Archive::is_valid_extension(const std::string& path)
 {
-    std::string ext = path.substr(path.find_last_of('.') + 1);
-    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
-
-    for (const std::string& e : FileExtensions)
-        if (ext == e)
-            return true;
-
-    return false;
+    static const ExtensionSet extensions{ FileExtensions };
+    return extensions.contains(path);
 }
 
 std::unique_ptr<Archive> Archive::create(const std::string& path, const std::string& parent_dir)
@@ -114,6 +110,12 @@ Archive::Archive(std::string path, std::string ex_dir)
     : m_Path(std::move(path)),
       m_ExtractedPath(std::move(ex_dir))
 {
+    GStatBuf file_info;
+    if (g_stat(m_Path.c_str(), &file_info) == 0)
+    {
+        m_MTime = file_info.st_mtime;
+        m_Size  = file_info.st_size;
+    }
 }
 
 Archive::~Archive()
@@ -2,6 +2,7 @@
 
 #include "../image.h"
 
+#include <cstdint>
 #include <functional>
 #include <sigc++/sigc++.h>
 
@@ -56,6 +57,9 @@ namespace AhoViewer
 
         const std::string get_path() const { return m_Path; }
         const std::string get_extracted_path() const { return m_ExtractedPath; }
+        // Of the archive file when it was opened, size is -1 if it couldn't be read
+        int64_t get_mtime() const { return m_MTime; }
+        int64_t get_size() const { return m_Size; }
 
         static const std::vector<std::string> MimeTypes, FileExtensions;
 
@@ -63,6 +67,7 @@ namespace AhoViewer
         Archive(std::string path, std::string ex_dir);
 
         std::string m_Path, m_ExtractedPath;
+        int64_t m_MTime{ 0 }, m_Size{ -1 };
 
     private:
         static Type get_type(const std::string& path);
@@ -3,6 +3,9 @@
 #include <giomm.h>
 using namespace AhoViewer;
 
+#include "settings.h"
+#include "thumbnailstore.h"
+
 Archive::Image::Image(const std::string& path, const Archive& archive)
     : AhoViewer::Image(Glib::build_filename(archive.get_extracted_path(), path)),
       m_ArchiveFilePath(path),
@@ -20,8 +23,25 @@ const Glib::RefPtr<Gdk::Pixbuf>& Archive::Image::get_thumbnail(Glib::RefPtr<Gio:
 {
     if (!m_ThumbnailPixbuf)
     {
-        extract_file();
-        create_thumbnail(c, false);
+        // The archive is a file so this can't be the path of a real file
+        const std::string key{ Glib::build_filename(m_Archive.get_path(), m_ArchiveFilePath) };
+        const bool use_store{ Settings.get_bool("ThumbnailDatabase") &&
+                              m_Archive.get_size() >= 0 };
+
+        if (use_store)
+            m_ThumbnailPixbuf = ThumbnailStore::get_instance().lookup(
+                key, m_Archive.get_mtime(), m_Archive.get_size());
+
+        if (!m_ThumbnailPixbuf)
+        {
+            extract_file();
+            create_thumbnail(c, false);
+
+            if (use_store && Settings.get_bool("SaveThumbnails") && m_ThumbnailPixbuf &&
+                !c->is_cancelled())
+                ThumbnailStore::get_instance().add(
+                    key, m_Archive.get_mtime(), m_Archive.get_size(), m_ThumbnailPixbuf);
+        }
     }
 
     return m_ThumbnailPixbuf;
@@ -30,6 +30,16 @@ size_t Curler::write_cb(const unsigned char* ptr, size_t size, size_t nmemb, voi
 
     size_t len{ size * nmemb };
 
+    // Allocate the whole download up front when the size is known so the buffer
+    // isn't copied every time it grows
+    if (self->m_Buffer.empty())
+    {
+        curl_off_t s;
+        curl_easy_getinfo(self->m_EasyHandle, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &s);
+        if (s > 0)
+            self->m_Buffer.reserve(s);
+    }
+
     self->m_Buffer.insert(self->m_Buffer.end(), ptr, ptr + len);
     self->m_SignalWrite(ptr, len);
 
@@ -193,11 +203,12 @@ void Curler::save_file(const std::string& path) const
     f->replace_contents(reinterpret_cast<const char*>(m_Buffer.data()), m_Buffer.size(), "", etag);
 }
 
-void Curler::save_file_async(const std::string& path, const Gio::SlotAsyncReady& cb)
+void Curler::save_file_async(const std::string& path,
+                             const Glib::RefPtr<Glib::Bytes>& data,
+                             const Gio::SlotAsyncReady& cb)
 {
     Glib::RefPtr<Gio::File> f{ Gio::File::create_for_path(path) };
-    f->replace_contents_async(
-        cb, m_Cancel, reinterpret_cast<const char*>(m_Buffer.data()), m_Buffer.size(), "");
+    f->replace_contents_bytes_async(cb, m_Cancel, data, "");
 }
 
 void Curler::save_file_finish(const Glib::RefPtr<Gio::AsyncResult>& r)
@@ -5,6 +5,8 @@
 #include <curl/curl.h>
 #include <giomm.h>
 #include <glibmm.h>
+#include <utility>
+#include <vector>
 
 namespace AhoViewer::Booru
 {
@@ -40,7 +42,10 @@ namespace AhoViewer::Booru
             std::vector<unsigned char>().swap(m_Buffer);
         }
         void save_file(const std::string& path) const;
-        void save_file_async(const std::string& path, const Gio::SlotAsyncReady& cb);
+        // Saves data instead of the buffer, used after the buffer has been taken
+        void save_file_async(const std::string& path,
+                             const Glib::RefPtr<Glib::Bytes>& data,
+                             const Gio::SlotAsyncReady& cb);
         void save_file_finish(const Glib::RefPtr<Gio::AsyncResult>& r);
 
         void get_progress(curl_off_t& current, curl_off_t& total);
@@ -50,6 +55,8 @@ namespace AhoViewer::Booru
 
         unsigned char* get_data() { return m_Buffer.data(); }
         size_t get_data_size() const { return m_Buffer.size(); }
+        // Moves the buffer out without copying it, leaving the curler empty
+        std::vector<unsigned char> take_data() { return std::exchange(m_Buffer, {}); }
 
         std::string get_error() const { return curl_easy_strerror(m_Response); }
         CURLcode get_response() const { return m_Response; }
@@ -219,13 +219,12 @@ void Image::on_write(const unsigned char* d, size_t l)
     if (m_Curler.is_cancelled())
         return;
 
-    if (!m_GIFanim && !m_IsGifChecked && m_Curler.get_data_size() >= 4)
+    if (!m_IsGifChecked && m_Curler.get_data_size() >= 4)
     {
         m_IsGifChecked = true;
         if (is_gif(m_Curler.get_data()))
         {
-            m_GIFanim = new gif_animation;
-            gif_create(m_GIFanim, &m_BitmapCallbacks);
+            m_IsGif = true;
             m_Pixbuf.reset();
             close_loader();
         }
@@ -260,15 +259,12 @@ void Image::on_finished()
 {
     if (m_Curler.get_data_size() > 0)
     {
-        if (m_GIFanim)
-        {
-            m_GIFdataSize = m_Curler.get_data_size();
-            m_GIFdata     = new unsigned char[m_GIFdataSize];
-            memcpy(m_GIFdata, m_Curler.get_data(), m_GIFdataSize);
+        // The GIF decoder and the file save share the downloaded buffer
+        auto data{ ImageData::create_from_buffer(m_Curler.take_data()) };
 
-            AhoViewer::Image::load_gif();
-        }
-        m_Curler.save_file_async(m_Path, [&](Glib::RefPtr<Gio::AsyncResult>& r) {
+        if (m_IsGif)
+            load_gif(data);
+        m_Curler.save_file_async(m_Path, data->get_bytes(), [&](Glib::RefPtr<Gio::AsyncResult>& r) {
             try
             {
                 m_Curler.save_file_finish(r);
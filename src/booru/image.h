@@ -75,7 +75,9 @@ namespace AhoViewer::Booru
 
         Curler m_Curler, m_ThumbnailCurler, m_NotesCurler;
         Glib::RefPtr<Gdk::PixbufLoader> m_Loader;
-        bool m_PixbufError{ false }, m_IsGifChecked{ false };
+        // m_IsGif is set once the start of the download has been checked, the animation
+        // is loaded by on_finished
+        bool m_PixbufError{ false }, m_IsGifChecked{ false }, m_IsGif{ false };
         std::shared_mutex m_ThumbnailLock;
 
         std::condition_variable m_DownloadCond, m_ThumbnailCond;
@@ -106,7 +106,7 @@ void ImageList::load(const std::vector<PostDataTuple>& posts, const size_t posts
     if (m_ThumbnailThread.joinable())
         m_ThumbnailThread.join();
 
-    m_ThumbnailThread = std::thread(sigc::mem_fun(*this, &ImageList::load_thumbnails));
+    start_thumbnail_thread();
 
     // Select the first image on initial load
     if (page->get_page_num() == 1)
@@ -125,22 +125,29 @@ void ImageList::set_current(const size_t index, const bool from_widget, const bo
     if (index == m_Index && !force)
         return;
 
-    m_Index = index;
+    {
+        std::scoped_lock lock{ m_ThumbnailMutex };
+        m_Index = index;
+    }
     m_SignalChanged(m_Images[m_Index]);
     update_cache();
+    reprioritize_thumbnails();
 
     if (!from_widget)
         m_Widget->set_selected(m_Index);
 }
 
-// Cancel all image thumbnail curlers.
+// Cancel all image thumbnail curlers first so the workers finish quickly, then stop the
+// workers and drop the pending thumbnails
 void ImageList::cancel_thumbnail_thread()
 {
-    m_ThumbnailCancel->cancel();
+    cancel_thumbnail_jobs();
 
     for (auto img : *this)
     {
         auto bimage = std::static_pointer_cast<Image>(img);
         bimage->cancel_thumbnail_download();
     }
+
+    AhoViewer::ImageList::cancel_thumbnail_thread();
 }
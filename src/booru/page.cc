@@ -7,6 +7,7 @@ using namespace AhoViewer::Booru;
 #include "site.h"
 #include "threadpool.h"
 
+#include <algorithm>
 #include <glibmm/i18n.h>
 #include <iostream>
 
@@ -66,11 +67,17 @@ Page::Page()
     m_ScrollConn = get_vadjustment()->signal_value_changed().connect(
         sigc::mem_fun(*this, &Page::on_value_changed));
 
+    // Thumbnails in view are loaded first
+    get_vadjustment()->signal_value_changed().connect([&]() { m_SignalVisibleRangeChanged(); });
+    get_vadjustment()->signal_changed().connect([&]() { m_SignalVisibleRangeChanged(); });
+    signal_map().connect([&]() { m_SignalVisibleRangeChanged(); });
+    signal_unmap().connect([&]() { m_SignalVisibleRangeChanged(); });
+
     m_IconView->set_column_spacing(0);
     m_IconView->set_margin(0);
     m_IconView->set_item_padding(IconViewItemPadding);
 
-    m_IconView->set_model(m_ListStore);
+    m_IconView->set_model(m_Model);
     m_IconView->set_selection_mode(Gtk::SELECTION_BROWSE);
     m_IconView->signal_selection_changed().connect(
         sigc::mem_fun(*this, &Page::on_selection_changed));
@@ -98,6 +105,7 @@ Page::Page()
 
 Page::~Page()
 {
+    m_AlignConn.disconnect();
     m_Curler.cancel();
 
     if (m_GetPostsThread.joinable())
@@ -105,21 +113,32 @@ Page::~Page()
 
     cancel_save();
 
-    m_ListStore->clear();
+    m_Model->clear();
 }
 
-void Page::set_pixbuf(const size_t index, const Glib::RefPtr<Gdk::Pixbuf>& pixbuf)
+void Page::set_pixbufs(const PixbufVector& pixbufs)
 {
     m_ScrollConn.block();
-    ImageList::Widget::set_pixbuf(index, pixbuf);
-    while (Glib::MainContext::get_default()->pending())
-        Glib::MainContext::get_default()->iteration(true);
+    ImageList::Widget::set_pixbufs(pixbufs);
     m_ScrollConn.unblock();
 
-    // Only keep the thumbnail aligned if the user has not scrolled
-    // and the thumbnail is most likely still being loaded
-    if (m_KeepAligned && m_ImageList->get_index() >= index)
-        scroll_to_selected();
+    // Only keep the thumbnail aligned if the user has not scrolled and the thumbnail is
+    // most likely still being loaded.  This is done once per batch after the frame that
+    // lays out the new items
+    const bool before_selected{ std::any_of(pixbufs.begin(), pixbufs.end(), [&](const auto& p) {
+        return m_ImageList->get_index() >= p.first;
+    }) };
+
+    if (m_KeepAligned && before_selected && !m_AlignConn)
+    {
+        // Idle handlers run after the icon view has laid out the new items
+        m_AlignConn = Glib::signal_idle().connect([&]() {
+            if (m_KeepAligned)
+                scroll_to_selected();
+
+            return false;
+        });
+    }
 }
 
 void Page::set_selected(const size_t index)
@@ -435,6 +454,18 @@ void Page::on_selection_changed()
     }
 }
 
+bool Page::get_visible_range(size_t& first, size_t& last) const
+{
+    Gtk::TreePath start, end;
+    if (!get_mapped() || !m_IconView->get_visible_range(start, end))
+        return false;
+
+    first = start[0];
+    last  = end[0];
+
+    return true;
+}
+
 // Vertical scrollbar value changed
 void Page::on_value_changed()
 {
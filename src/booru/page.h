@@ -32,9 +32,12 @@ namespace AhoViewer::Booru
         SignalSaveProgressType signal_save_progress() const { return m_SignalSaveProgress; }
 
     protected:
-        void set_pixbuf(const size_t index, const Glib::RefPtr<Gdk::Pixbuf>& pixbuf) override;
+        void set_pixbufs(const PixbufVector& pixbufs) override;
         void set_selected(const size_t index) override;
         void scroll_to_selected() override;
+        bool get_visible_range(size_t& first, size_t& last) const override;
+        void detach_model() override { m_IconView->unset_model(); }
+        void attach_model() override { m_IconView->set_model(m_Model); }
 
     private:
         class IconView : public Gtk::IconView
@@ -133,7 +136,7 @@ namespace AhoViewer::Booru
         std::thread m_GetPostsThread, m_SaveImagesThread;
         Glib::Dispatcher m_SignalPostsDownloaded, m_SignalSaveProgressDisp;
 
-        sigc::connection m_GetNextPageConn, m_ScrollConn;
+        sigc::connection m_GetNextPageConn, m_ScrollConn, m_AlignConn;
 
         SignalClosedType m_SignalClosed;
         SignalDownloadErrorType m_SignalDownloadError;
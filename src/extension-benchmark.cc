@@ -0,0 +1,105 @@
+// Compares the per entry cost of filtering a 100k entry directory listing by extension,
+// listing the GdkPixbuf formats for every entry like Image::is_valid_extension used to
+// against the ExtensionSet it builds once.  Built when the benchmarks option is enabled
+// and run with meson test --benchmark
+#include "extensionset.h"
+using namespace AhoViewer;
+
+#include <chrono>
+#include <cstring>
+#include <gdkmm.h>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+namespace
+{
+    constexpr size_t Entries{ 100000 };
+    constexpr int Iterations{ 5 };
+
+    bool is_valid_extension_formats(const std::string& path)
+    {
+        std::string ext = path.substr(path.find_last_of('.') + 1);
+        std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+
+        bool r = false;
+
+        for (Gdk::PixbufFormat i : Gdk::Pixbuf::get_formats())
+        {
+            gchar** extensions = gdk_pixbuf_format_get_extensions(i.gobj());
+            for (int j = 0; extensions[j] != nullptr; ++j)
+            {
+                if (strcmp(ext.c_str(), extensions[j]) == 0)
+                    r = true;
+            }
+
+            g_strfreev(extensions);
+
+            if (r)
+                break;
+        }
+
+        return r;
+    }
+
+    ExtensionSet create_extension_set()
+    {
+        std::vector<std::string> exts;
+
+        for (Gdk::PixbufFormat i : Gdk::Pixbuf::get_formats())
+        {
+            gchar** e = gdk_pixbuf_format_get_extensions(i.gobj());
+            for (int j = 0; e[j] != nullptr; ++j)
+                exts.emplace_back(e[j]);
+
+            g_strfreev(e);
+        }
+
+        return ExtensionSet{ exts };
+    }
+
+    template<typename T>
+    void run(const char* name, const std::vector<std::string>& entries, T&& func)
+    {
+        using namespace std::chrono;
+        double best{ 0 };
+        size_t valid{ 0 };
+
+        for (int i = 0; i < Iterations; ++i)
+        {
+            valid = 0;
+            auto start{ steady_clock::now() };
+            for (const std::string& e : entries)
+                valid += func(e);
+            double ms{ duration<double, std::milli>(steady_clock::now() - start).count() };
+            best = i == 0 ? ms : std::min(best, ms);
+        }
+
+        std::cout << std::setw(20) << std::left << name << std::fixed << std::setprecision(1)
+                  << best << " ms, " << std::setprecision(0) << best * 1e6 / entries.size()
+                  << " ns/entry (" << valid << " valid)" << std::endl;
+    }
+}
+
+int main()
+{
+    Gio::init();
+    Gdk::wrap_init();
+
+    const char* const exts[]{ "jpg", "PNG", "jpeg", "gif", "webp", "txt", "cbz", "Thumbs.db" };
+    std::vector<std::string> entries;
+    entries.reserve(Entries);
+
+    for (size_t i = 0; i < Entries; ++i)
+        entries.push_back("/home/user/Pictures/some directory/image " + std::to_string(i) + "." +
+                          exts[i % (sizeof(exts) / sizeof(*exts))]);
+
+    std::cout << entries.size() << " entries" << std::endl;
+
+    run("Pixbuf formats", entries, is_valid_extension_formats);
+
+    const ExtensionSet set{ create_extension_set() };
+    run("ExtensionSet", entries, [&](const std::string& e) { return set.contains(e); });
+
+    return 0;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace AhoViewer
+{
+    // An immutable set of lowercase file extensions.  It is safe to check paths against
+    // from any thread once constructed
+    class ExtensionSet
+    {
+    public:
+        explicit ExtensionSet(const std::vector<std::string>& extensions)
+        {
+            for (std::string e : extensions)
+            {
+                std::transform(e.begin(), e.end(), e.begin(), ::tolower);
+                m_MaxLength = std::max(m_MaxLength, e.size());
+                m_Extensions.insert(std::move(e));
+            }
+        }
+
+        // Returns true if the text after the last '.' in path is one of the extensions,
+        // ignoring case.  A path without a '.' is compared as a whole
+        bool contains(const std::string& path) const
+        {
+            const size_t start{ path.find_last_of('.') + 1 };
+
+            // Longer than any of the extensions, this also keeps ext from allocating
+            if (path.size() - start > m_MaxLength)
+                return false;
+
+            std::string ext(path, start);
+            std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+
+            return m_Extensions.count(ext) != 0;
+        }
+
+    private:
+        std::unordered_set<std::string> m_Extensions;
+        size_t m_MaxLength{ 0 };
+    };
+}
@@ -0,0 +1,157 @@
+#include "gifframestore.h"
+using namespace AhoViewer;
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+GIFFrameStore::GIFFrameStore(const int w, const int h, const size_t limit)
+    : m_Width{ w },
+      m_Height{ h },
+      m_Limit{ limit }
+{
+}
+
+bool GIFFrameStore::add(const int index, const uint32_t* pixels)
+{
+    if (m_Full || static_cast<size_t>(index) != m_Frames.size())
+        return false;
+
+    const size_t frame_size{ static_cast<size_t>(m_Width) * m_Height };
+    int x0{ 0 }, y0{ 0 }, x1{ m_Width - 1 }, y1{ m_Height - 1 };
+
+    // Find the rectangle that changed since the last frame
+    if (index % KeyframeInterval != 0)
+    {
+        x0 = m_Width;
+        y0 = m_Height;
+        x1 = y1 = -1;
+
+        for (int y = 0; y < m_Height; ++y)
+        {
+            const uint32_t *row{ pixels + y * m_Width }, *last{ m_Last.data() + y * m_Width };
+            if (std::memcmp(row, last, m_Width * sizeof(uint32_t)) == 0)
+                continue;
+
+            int l{ 0 }, r{ m_Width - 1 };
+            while (row[l] == last[l])
+                ++l;
+            while (row[r] == last[r])
+                --r;
+
+            x0 = std::min(x0, l);
+            x1 = std::max(x1, r);
+            y0 = std::min(y0, y);
+            y1 = y;
+        }
+
+        // Nothing changed
+        if (x1 < 0)
+            x0 = y0 = x1 = y1 = 0;
+    }
+
+    Frame frame{ encode(pixels, m_Width, x0, y0, x1 - x0 + 1, y1 - y0 + 1) };
+    size_t size{ frame.data.size() + frame.palette.size() * sizeof(uint32_t) };
+
+    // The two full frame buffers are counted with the first frame
+    if (m_Frames.empty())
+        size += frame_size * sizeof(uint32_t) * 2;
+
+    if (m_MemorySize + size > m_Limit)
+    {
+        m_Full = true;
+        return false;
+    }
+
+    if (m_Last.empty())
+        m_Last.resize(frame_size);
+    std::copy(pixels, pixels + frame_size, m_Last.begin());
+
+    m_Frames.push_back(std::move(frame));
+    m_MemorySize += size;
+
+    return true;
+}
+
+bool GIFFrameStore::get(const int index, uint32_t* pixels)
+{
+    if (!has(index))
+        return false;
+
+    if (m_Cursor.empty())
+        m_Cursor.resize(static_cast<size_t>(m_Width) * m_Height);
+
+    // Start from the nearest keyframe unless the cursor is already between it and index
+    const int keyframe{ index - index % KeyframeInterval };
+    if (m_CursorIndex < keyframe || m_CursorIndex > index)
+    {
+        decode(m_Frames[keyframe], m_Cursor.data(), m_Width);
+        m_CursorIndex = keyframe;
+    }
+
+    while (m_CursorIndex < index)
+        decode(m_Frames[++m_CursorIndex], m_Cursor.data(), m_Width);
+
+    std::copy(m_Cursor.begin(), m_Cursor.end(), pixels);
+
+    return true;
+}
+
+GIFFrameStore::Frame
+GIFFrameStore::encode(const uint32_t* pixels, const int stride, int x, int y, int w, int h)
+{
+    Frame frame{ x, y, w, h, {}, {} };
+    std::unordered_map<uint32_t, uint8_t> colors;
+
+    frame.data.resize(static_cast<size_t>(w) * h);
+    for (int r = 0; r < h; ++r)
+    {
+        const uint32_t* row{ pixels + (y + r) * stride + x };
+        for (int c = 0; c < w; ++c)
+        {
+            auto it{ colors.find(row[c]) };
+            if (it == colors.end())
+            {
+                // Too many colors for palette indices
+                if (colors.size() == 256)
+                {
+                    frame.palette.clear();
+                    frame.data.resize(static_cast<size_t>(w) * h * sizeof(uint32_t));
+                    for (int i = 0; i < h; ++i)
+                        std::memcpy(frame.data.data() + static_cast<size_t>(i) * w * 4,
+                                    pixels + (y + i) * stride + x,
+                                    w * sizeof(uint32_t));
+                    return frame;
+                }
+
+                it = colors.emplace(row[c], colors.size()).first;
+                frame.palette.push_back(row[c]);
+            }
+
+            frame.data[static_cast<size_t>(r) * w + c] = it->second;
+        }
+    }
+
+    return frame;
+}
+
+void GIFFrameStore::decode(const Frame& frame, uint32_t* pixels, const int stride)
+{
+    for (int r = 0; r < frame.h; ++r)
+    {
+        uint32_t* row{ pixels + (frame.y + r) * stride + frame.x };
+
+        if (frame.palette.empty())
+        {
+            std::memcpy(row,
+                        frame.data.data() + static_cast<size_t>(r) * frame.w * 4,
+                        frame.w * sizeof(uint32_t));
+        }
+        else
+        {
+            const uint8_t* indices{ frame.data.data() + static_cast<size_t>(r) * frame.w };
+            for (int c = 0; c < frame.w; ++c)
+                row[c] = frame.palette[indices[c]];
+        }
+    }
+}
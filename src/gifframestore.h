@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace AhoViewer
+{
+    // Keeps every decoded frame of an animated GIF so it doesn't need to be decoded
+    // again when looping.  Frames are stored as the rectangle that changed since the
+    // previous frame, with every KeyframeInterval frame stored in full so seeking only
+    // has to apply a few deltas.  Rectangles with 256 colors or less are stored as
+    // palette indices.  Frames are added in order until the memory limit is reached
+    class GIFFrameStore
+    {
+        struct Frame
+        {
+            int x, y, w, h;
+            std::vector<uint32_t> palette;
+            // Palette indices, or RGBA pixels when palette is empty
+            std::vector<uint8_t> data;
+        };
+
+    public:
+        GIFFrameStore(const int w, const int h, const size_t limit);
+
+        // Stores the frame in pixels, which must be the frame after the last one added.
+        // Returns false if it wasn't stored
+        bool add(const int index, const uint32_t* pixels);
+        // Copies the frame in to pixels, returns false if it hasn't been stored
+        bool get(const int index, uint32_t* pixels);
+
+        bool has(const int index) const
+        {
+            return index >= 0 && static_cast<size_t>(index) < m_Frames.size();
+        }
+        size_t get_memory_size() const { return m_MemorySize; }
+
+        static constexpr int KeyframeInterval{ 32 };
+
+    private:
+        static Frame encode(const uint32_t* pixels, const int stride, int x, int y, int w, int h);
+        static void decode(const Frame& frame, uint32_t* pixels, const int stride);
+
+        const int m_Width, m_Height;
+        const size_t m_Limit;
+        bool m_Full{ false };
+        std::vector<Frame> m_Frames;
+        // The last frame added, and the last frame returned by get
+        std::vector<uint32_t> m_Last, m_Cursor;
+        int m_CursorIndex{ -1 };
+        std::atomic<size_t> m_MemorySize{ 0 };
+    };
+}
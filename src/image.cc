@@ -1,50 +1,57 @@
 #include "image.h"
 using namespace AhoViewer;
 
+#include "extensionset.h"
+#include "resampler.h"
 #include "settings.h"
+#include "thumbnailstore.h"
 
+#include <algorithm>
 #include <cctype>
+#include <cmath>
 #include <giomm.h>
 #include <glib.h>
+#include <glib/gstdio.h>
 #include <gtkmm.h>
 #include <iostream>
+#include <utility>
 
 const std::string Image::ThumbnailDir =
     Glib::build_filename(Glib::get_user_cache_dir(), "thumbnails", "normal");
 
+std::mutex Image::FitSizeMutex;
+int Image::FitWidth{ 0 }, Image::FitHeight{ 0 };
+ZoomMode Image::FitZoomMode{ ZoomMode::MANUAL };
+
 bool Image::is_valid(const std::string& path)
 {
     return gdk_pixbuf_get_file_info(path.c_str(), nullptr, nullptr) != nullptr || is_webm(path);
 }
 
+// The extensions of every GdkPixbuf loader, built once on first use.  Listing the loaders
+// allocates, and this is called for every file in a directory or archive
 bool Image::is_valid_extension(const std::string& path)
 {
-    std::string ext = path.substr(path.find_last_of('.') + 1);
-    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    static const ExtensionSet extensions{ []() {
+        std::vector<std::string> exts;
 
 #ifdef HAVE_GSTREAMER
-    if (ext == "webm" || ext == "mp4")
-        return true;
+        exts.insert(exts.end(), { "webm", "mp4" });
 #endif // HAVE_GSTREAMER
 
-    bool r = false;
-
-    for (Gdk::PixbufFormat i : Gdk::Pixbuf::get_formats())
-    {
-        gchar** extensions = gdk_pixbuf_format_get_extensions(i.gobj());
-        for (int j = 0; extensions[j] != nullptr; ++j)
+        for (Gdk::PixbufFormat i : Gdk::Pixbuf::get_formats())
         {
-            if (strcmp(ext.c_str(), extensions[j]) == 0)
-                r = true;
-        }
+            gchar** e = gdk_pixbuf_format_get_extensions(i.gobj());
+            for (int j = 0; e[j] != nullptr; ++j)
+                exts.emplace_back(e[j]);
 
-        g_strfreev(extensions);
+            g_strfreev(e);
+        }
 
-        if (r)
-            break;
-    }
+        return exts;
+    }() };
 
-    return r;
+    return extensions.contains(path);
 }
 
 bool Image::is_webm([[maybe_unused]] const std::string& path)
@@ -68,6 +75,69 @@ const Glib::RefPtr<Gdk::Pixbuf>& Image::get_missing_pixbuf()
     return pixbuf;
 }
 
+bool Image::set_fit_size(const int w, const int h, const ZoomMode zoom_mode)
+{
+    std::scoped_lock lock{ FitSizeMutex };
+    if (w == FitWidth && h == FitHeight && zoom_mode == FitZoomMode)
+        return false;
+
+    FitWidth    = w;
+    FitHeight   = h;
+    FitZoomMode = zoom_mode;
+
+    return true;
+}
+
+bool Image::fit_to_area(int& w, int& h, const int ww, const int wh, const ZoomMode zoom_mode)
+{
+    if (w <= 0 || h <= 0)
+        return false;
+
+    double window_aspect = static_cast<double>(ww) / wh, image_aspect = static_cast<double>(w) / h;
+
+    // These do not take the scrollbar size in to account, because I assume that
+    // overlay scrollbars are enabled
+    if (w > ww && (zoom_mode == ZoomMode::FIT_WIDTH ||
+                   (zoom_mode == ZoomMode::AUTO_FIT && window_aspect <= image_aspect)))
+    {
+        w = ww;
+        h = std::ceil(w / image_aspect);
+        return true;
+    }
+    else if (h > wh && (zoom_mode == ZoomMode::FIT_HEIGHT ||
+                        (zoom_mode == ZoomMode::AUTO_FIT && window_aspect >= image_aspect)))
+    {
+        h = wh;
+        w = std::ceil(h * image_aspect);
+        return true;
+    }
+
+    return false;
+}
+
+bool Image::get_fit_area(int& ww, int& wh, ZoomMode& zoom_mode)
+{
+    std::scoped_lock lock{ FitSizeMutex };
+    ww        = FitWidth;
+    wh        = FitHeight;
+    zoom_mode = FitZoomMode;
+
+    return ww > 0 && wh > 0;
+}
+
+// Sets w and h to the size an image of w x h will be drawn at.
+// Returns false if the image would not be scaled down, or DecodeAtFitSize is disabled
+bool Image::get_fit_size(int& w, int& h)
+{
+    int ww, wh;
+    ZoomMode zoom_mode;
+
+    if (!Settings.get_bool("DecodeAtFitSize") || !get_fit_area(ww, wh, zoom_mode))
+        return false;
+
+    return fit_to_area(w, h, ww, wh, zoom_mode);
+}
+
 static void* _def_bitmap_create(int width, int height)
 {
     return new unsigned char[width * height * 4];
@@ -114,38 +184,42 @@ const Glib::RefPtr<Gdk::Pixbuf>& Image::get_pixbuf()
     return m_Pixbuf;
 }
 
-// Private method used internally by gif_advance_frame
-// and by get_pixbuf when m_Pixbuf is null
-void Image::create_gif_frame_pixbuf()
+void Image::get_size(int& w, int& h)
 {
     std::scoped_lock lock{ m_Mutex };
-    gif_result result = gif_decode_frame(m_GIFanim, m_GIFcurFrame);
 
-    if (result == GIF_OK)
+    if (m_Scaled)
     {
-        m_Pixbuf =
-            Gdk::Pixbuf::create_from_data(static_cast<unsigned char*>(m_GIFanim->frame_image),
-                                          Gdk::COLORSPACE_RGB,
-                                          true,
-                                          8,
-                                          m_GIFanim->width,
-                                          m_GIFanim->height,
-                                          (m_GIFanim->width * 4 + 3) & ~3);
-        m_SignalPixbufChanged();
+        w = m_Width;
+        h = m_Height;
     }
     else
     {
-        std::cerr << "Error while decoding GIF frame " << m_GIFcurFrame << " of " << m_Path
-                  << std::endl
-                  << "gif_result: " << result << std::endl;
+        w = m_Pixbuf ? m_Pixbuf->get_width() : 0;
+        h = m_Pixbuf ? m_Pixbuf->get_height() : 0;
     }
 }
 
+// Private method used internally by load_gif to decode the first frame,
+// the rest are decoded by the decoder thread
 const Glib::RefPtr<Gdk::Pixbuf>& Image::get_thumbnail(Glib::RefPtr<Gio::Cancellable> c)
 {
     if (m_ThumbnailPixbuf)
         return m_ThumbnailPixbuf;
 
+    GStatBuf file_info;
+    const bool use_store{ Settings.get_bool("ThumbnailDatabase") &&
+                          g_stat(m_Path.c_str(), &file_info) == 0 };
+
+    if (use_store)
+    {
+        m_ThumbnailPixbuf = ThumbnailStore::get_instance().lookup(
+            m_Path, file_info.st_mtime, file_info.st_size);
+
+        if (m_ThumbnailPixbuf)
+            return m_ThumbnailPixbuf;
+    }
+
 #ifdef __linux__
     std::string thumb_filename = Glib::Checksum::compute_checksum(Glib::Checksum::CHECKSUM_MD5,
                                                                   Glib::filename_to_uri(m_Path)) +
@@ -177,6 +251,12 @@ const Glib::RefPtr<Gdk::Pixbuf>& Image::get_thumbnail(Glib::RefPtr<Gio::Cancella
     if (!m_ThumbnailPixbuf)
         create_thumbnail(c);
 
+    // Like the freedesktop thumbnails, nothing is written when SaveThumbnails is off
+    if (use_store && Settings.get_bool("SaveThumbnails") && m_ThumbnailPixbuf &&
+        !c->is_cancelled())
+        ThumbnailStore::get_instance().add(
+            m_Path, file_info.st_mtime, file_info.st_size, m_ThumbnailPixbuf);
+
     return m_ThumbnailPixbuf;
 }
 
@@ -184,38 +264,36 @@ void Image::load_pixbuf(Glib::RefPtr<Gio::Cancellable> c)
 {
     if (!m_Pixbuf && !m_IsWebM)
     {
-        Glib::RefPtr<Gio::File> file{ Gio::File::create_for_path(m_Path) };
-
-        std::array<unsigned char, 4> data;
-        file->read()->read(&data, 4);
-
-        if (is_gif(data.data()))
+        std::shared_ptr<ImageData> data;
+        try
         {
-            m_GIFanim = new gif_animation;
-            gif_create(m_GIFanim, &m_BitmapCallbacks);
-
-            char* buffer;
-            // returns false if c was cancelled, and frees the buffer for us?
-            if (file->load_contents(c, buffer, m_GIFdataSize))
-            {
-                m_GIFdata = new unsigned char[m_GIFdataSize];
-                memcpy(m_GIFdata, buffer, m_GIFdataSize);
-                free(buffer);
-
-                load_gif();
-            }
+            data = ImageData::create_from_file(m_Path);
         }
+        catch (const Glib::FileError& e)
+        {
+            std::cerr << "Failed to open file '" << m_Path << "'" << std::endl
+                      << e.what() << std::endl;
+            return;
+        }
+
+        // libnsgif reads the data for as long as the animation lives, the decoder thread
+        // checks the mapping is still intact before each frame
+        if (data->get_size() >= 4 && is_gif(data->get_data()))
+            load_gif(std::move(data));
         else
         {
             Glib::RefPtr<Gdk::Pixbuf> p{ nullptr };
+            int w{ 0 }, h{ 0 };
             try
             {
-                p = Gdk::Pixbuf::create_from_stream(file->read(), c);
+                p = create_fitted_pixbuf(data, c, w, h);
             }
-            catch (const Gdk::PixbufError& e)
+            // Thrown if the image could not be decoded, a cancelled load returns nullptr
+            catch (const Glib::Error& e)
             {
-                std::cerr << "Failed to load pixbuf from file '" << m_Path << "'" << std::endl
-                          << e.what() << std::endl;
+                if (!c->is_cancelled())
+                    std::cerr << "Failed to load pixbuf from file '" << m_Path << "'" << std::endl
+                              << e.what() << std::endl;
             }
 
             if (!p || c->is_cancelled())
@@ -224,6 +302,11 @@ void Image::load_pixbuf(Glib::RefPtr<Gio::Cancellable> c)
             {
                 std::scoped_lock lock{ m_Mutex };
                 m_Pixbuf = p;
+                m_Mipmaps.clear();
+                m_FitPixbuf = {};
+                m_Scaled = w != 0;
+                m_Width  = w;
+                m_Height = h;
             }
         }
 
@@ -232,83 +315,503 @@ void Image::load_pixbuf(Glib::RefPtr<Gio::Cancellable> c)
     }
 }
 
-// Call this once m_GIFdata has been set
-void Image::load_gif()
+// Decodes a scaled image again at the current fit size, or at full resolution if it
+// would not be scaled down anymore.  Used when the image needs to be drawn larger
+// than it was decoded at
+void Image::reload_pixbuf(Glib::RefPtr<Gio::Cancellable> c)
+{
+    // Animated GIF frames are scaled by the decoder thread
+    {
+        std::scoped_lock lock{ m_Mutex };
+        if (!m_Scaled || m_GIFanim)
+            return;
+    }
+
+    Glib::RefPtr<Gdk::Pixbuf> p{ nullptr };
+    int w{ 0 }, h{ 0 };
+    try
+    {
+        p = create_fitted_pixbuf(ImageData::create_from_file(m_Path), c, w, h);
+    }
+    catch (const Glib::Error& e)
+    {
+        if (!c->is_cancelled())
+            std::cerr << "Failed to reload pixbuf from file '" << m_Path << "'" << std::endl
+                      << e.what() << std::endl;
+    }
+
+    if (!p || c->is_cancelled())
+        return;
+
+    {
+        std::scoped_lock lock{ m_Mutex };
+        // The image was freed while this was decoding, or it did not get any larger
+        if (!m_Pixbuf || p->get_width() <= m_Pixbuf->get_width())
+            return;
+
+        m_Pixbuf = p;
+        m_Mipmaps.clear();
+        m_FitPixbuf = {};
+        m_Scaled = w != 0;
+        m_Width  = w;
+        m_Height = h;
+    }
+
+    m_SignalPixbufChanged();
+}
+
+// The animation is built and its first frame decoded before it replaces m_GIFanim, so
+// the GUI thread never sees one that is half initialised.  The previous animation is freed
+void Image::load_gif(std::shared_ptr<ImageData> data)
 {
+    auto* anim{ new gif_animation };
+    gif_create(anim, &m_BitmapCallbacks);
+
     gif_result result;
     do
     {
-        result = gif_initialise(m_GIFanim, m_GIFdataSize, m_GIFdata);
-        if (result != GIF_OK && result != GIF_WORKING)
-        {
-            std::cerr << "Error while loading GIF " << m_Path << std::endl
-                      << "gif_result: " << result << std::endl;
-            break;
-        }
-        else if (result == GIF_OK)
+        // libnsgif never writes to the data, it just isn't declared const
+        result =
+            gif_initialise(anim, data->get_size(), const_cast<unsigned char*>(data->get_data()));
+    } while (result == GIF_WORKING);
+
+    if (result == GIF_OK)
+        result = gif_decode_frame(anim, 0);
+
+    if (result != GIF_OK)
+    {
+        std::cerr << "Error while loading GIF " << m_Path << std::endl
+                  << "gif_result: " << result << std::endl;
+        gif_finalise(anim);
+        delete anim;
+        return;
+    }
+
+    auto pixbuf{ Gdk::Pixbuf::create_from_data(static_cast<unsigned char*>(anim->frame_image),
+                                               Gdk::COLORSPACE_RGB,
+                                               true,
+                                               8,
+                                               anim->width,
+                                               anim->height,
+                                               (anim->width * 4 + 3) & ~3) };
+
+    gif_animation* old_anim;
+    std::shared_ptr<ImageData> old_data;
+    {
+        std::scoped_lock thread_lock{ m_GIFThreadMutex };
+        join_gif_decoder();
+
         {
-            // Load the first frame
-            create_gif_frame_pixbuf();
+            std::scoped_lock lock{ m_Mutex };
+            old_anim = std::exchange(m_GIFanim, anim);
+            old_data = std::exchange(m_GIFData, std::move(data));
+            m_GIFFrameStore.reset();
+            m_GIFFrameStoreSize = 0;
+            m_Mipmaps.clear();
+            m_FitPixbuf = {};
+            m_Scaled    = false;
+            m_Pixbuf    = pixbuf;
         }
-    } while (result != GIF_OK);
+
+        std::scoped_lock lock{ m_GIFMutex };
+        m_GIFcurFrame = 0;
+        m_GIFcurLoop  = 1;
+    }
+
+    // old_data is kept until here since libnsgif may read it while finalising
+    if (old_anim)
+    {
+        gif_finalise(old_anim);
+        delete old_anim;
+    }
+
+    m_SignalPixbufChanged();
 }
 
 void Image::reset_pixbuf()
 {
+    // Held until the animation is freed so the GUI thread can't start the decoder on it
+    std::scoped_lock thread_lock{ m_GIFThreadMutex };
+    join_gif_decoder();
     m_Loading = true;
     std::scoped_lock lock{ m_Mutex };
     m_Pixbuf.reset();
+    m_Mipmaps.clear();
+    m_FitPixbuf = {};
+    m_Scaled = false;
 
     if (m_GIFanim)
     {
         gif_finalise(m_GIFanim);
         delete m_GIFanim;
         m_GIFanim = nullptr;
+        m_GIFFrameStore.reset();
+        m_GIFFrameStoreSize = 0;
+        m_GIFData.reset();
 
-        if (m_GIFdata)
-        {
-            delete[] m_GIFdata;
-            m_GIFdata = nullptr;
-        }
+        std::scoped_lock gif_lock{ m_GIFMutex };
+        m_GIFcurFrame = 0;
+        m_GIFcurLoop  = 1;
+    }
+}
+
+// Builds the mipmap levels of the current pixbuf.  Each level is scaled down from
+// the previous one, so every step is a cheap 2:1 reduction
+void Image::build_mipmaps(Glib::RefPtr<Gio::Cancellable> c)
+{
+    Glib::RefPtr<Gdk::Pixbuf> pixbuf;
+    {
+        std::scoped_lock lock{ m_Mutex };
+        if (!m_Pixbuf || !m_Mipmaps.empty() || m_GIFanim)
+            return;
+
+        pixbuf = m_Pixbuf;
+    }
+
+    std::vector<Glib::RefPtr<Gdk::Pixbuf>> mipmaps;
+    Glib::RefPtr<Gdk::Pixbuf> level{ pixbuf };
+
+    while (!c->is_cancelled() && level->get_width() / 2 >= MinMipmapSize &&
+           level->get_height() / 2 >= MinMipmapSize)
+    {
+        level = Resampler::scale(
+            level, level->get_width() / 2, level->get_height() / 2, ScalingFilter::AREA);
+        mipmaps.push_back(level);
+    }
+
+    if (c->is_cancelled() || mipmaps.empty())
+        return;
+
+    {
+        std::scoped_lock lock{ m_Mutex };
+        // The pixbuf changed while the mipmaps were being built
+        if (m_Pixbuf != pixbuf)
+            return;
+
+        m_Mipmaps = std::move(mipmaps);
+    }
+
+    m_SignalPixbufChanged();
+}
+
+bool Image::has_mipmaps()
+{
+    std::scoped_lock lock{ m_Mutex };
+    return !m_Mipmaps.empty();
+}
+
+Glib::RefPtr<Gdk::Pixbuf> Image::get_mipmap(const int w, const int h)
+{
+    std::scoped_lock lock{ m_Mutex };
+
+    for (auto it = m_Mipmaps.rbegin(); it != m_Mipmaps.rend(); ++it)
+        if ((*it)->get_width() >= w && (*it)->get_height() >= h)
+            return *it;
+
+    return m_Pixbuf;
+}
+
+void Image::create_fit_pixbuf(Glib::RefPtr<Gio::Cancellable> c)
+{
+    if (is_loading())
+        return;
+
+    Glib::RefPtr<Gdk::Pixbuf> pixbuf;
+    int w, h;
+    {
+        std::scoped_lock lock{ m_Mutex };
+        if (!m_Pixbuf || m_GIFanim)
+            return;
+
+        pixbuf = m_Pixbuf;
+        w      = m_Scaled ? m_Width : m_Pixbuf->get_width();
+        h      = m_Scaled ? m_Height : m_Pixbuf->get_height();
+    }
+
+    int ww, wh;
+    ZoomMode zoom_mode;
+    const ScalingFilter filter{ Settings.get_scaling_filter() };
 
-        reset_gif_animation();
+    // Images that are drawn unscaled, or were already decoded at the fit size don't need it
+    if (!get_fit_area(ww, wh, zoom_mode) || !fit_to_area(w, h, ww, wh, zoom_mode) ||
+        (w == pixbuf->get_width() && h == pixbuf->get_height()))
+    {
+        reset_fit_pixbuf();
+        return;
+    }
+
+    {
+        std::scoped_lock lock{ m_Mutex };
+        if (m_FitPixbuf.matches(pixbuf, w, h, filter))
+            return;
+    }
+
+    auto scaled{ Resampler::scale(pixbuf, w, h, filter) };
+
+    if (c->is_cancelled())
+        return;
+
+    std::scoped_lock lock{ m_Mutex };
+    // The pixbuf changed while it was being scaled
+    if (m_Pixbuf == pixbuf)
+        m_FitPixbuf = { pixbuf, scaled, w, h, filter };
+}
+
+Image::ScaledPixbuf Image::get_fit_pixbuf()
+{
+    std::scoped_lock lock{ m_Mutex };
+    return m_FitPixbuf;
+}
+
+void Image::reset_fit_pixbuf()
+{
+    std::scoped_lock lock{ m_Mutex };
+    m_FitPixbuf = {};
+}
+
+size_t Image::get_memory_size()
+{
+    std::scoped_lock lock{ m_Mutex };
+
+    if (m_GIFanim)
+    {
+        // Mapped files are backed by the page cache which the kernel can drop
+        size_t size{ m_GIFData && !m_GIFData->is_mapped() ? m_GIFData->get_size() : 0 };
+        if (m_GIFanim->frame_image)
+            size += static_cast<size_t>(m_GIFanim->width) * m_GIFanim->height * 4;
+
+        // m_Pixbuf wraps the frame_image buffer until the decoder thread is started
+        if (m_Pixbuf && m_Pixbuf->get_pixels() != m_GIFanim->frame_image)
+            size += m_Pixbuf->get_byte_length();
+
+        size += m_GIFFrameStoreSize;
+
+        std::scoped_lock gif_lock{ m_GIFMutex };
+        for (const auto& f : m_GIFFrames)
+            size += f.pixbuf->get_byte_length();
+
+        return size;
     }
+
+    size_t size{ m_Pixbuf ? m_Pixbuf->get_byte_length() : 0 };
+    for (const auto& m : m_Mipmaps)
+        size += m->get_byte_length();
+    if (m_FitPixbuf.pixbuf)
+        size += m_FitPixbuf.pixbuf->get_byte_length();
+
+    return size;
 }
 
+// If the decoder thread hasn't finished decoding the next frame the current one
+// stays up until the next call, instead of blocking the GUI thread
 bool Image::gif_advance_frame()
 {
-    // Handle frame advacing and looping.
-    if (m_GIFanim->frame_count > 1)
+    start_gif_decoder();
+
+    GIFFrame f;
+    bool have_frame{ false };
     {
-        // Currently on the last frame, reset to first frame unless we finished
-        // the final loop
-        if (m_GIFcurFrame == static_cast<int>(m_GIFanim->frame_count) - 1 &&
-            m_GIFcurLoop != m_GIFanim->loop_count)
+        std::scoped_lock lock{ m_GIFMutex };
+        if (!m_GIFFrames.empty())
         {
-            // Only increment the loop counter if it's not looping forever.
-            if (m_GIFanim->loop_count > 0)
-                ++m_GIFcurLoop;
-            m_GIFcurFrame = 0;
+            f = std::move(m_GIFFrames.front());
+            m_GIFFrames.pop_front();
+            m_GIFcurFrame = f.frame;
+            m_GIFcurLoop  = f.loop;
+            have_frame    = true;
         }
-        else if (m_GIFcurFrame < static_cast<int>(m_GIFanim->frame_count) - 1)
+    }
+
+    // get_gif_finished_looping takes m_Mutex, get_memory_size takes m_GIFMutex with m_Mutex
+    // held so m_Mutex is never taken with m_GIFMutex held
+    if (!have_frame)
+        return get_gif_finished_looping();
+
+    m_GIFCond.notify_one();
+
+    {
+        std::scoped_lock lock{ m_Mutex };
+        m_Pixbuf = f.pixbuf;
+        m_Scaled = m_Pixbuf->get_width() != static_cast<int>(m_GIFanim->width) ||
+                   m_Pixbuf->get_height() != static_cast<int>(m_GIFanim->height);
+        m_Width  = m_GIFanim->width;
+        m_Height = m_GIFanim->height;
+    }
+    m_SignalPixbufChanged();
+
+    return get_gif_finished_looping();
+}
+
+void Image::set_gif_frame_size(const int w, const int h)
+{
+    {
+        std::scoped_lock lock{ m_GIFMutex };
+        m_GIFFrameWidth  = w;
+        m_GIFFrameHeight = h;
+    }
+
+    start_gif_decoder();
+}
+
+// Sets frame and loop to the ones after them, returns false once the final loop
+// has finished
+bool Image::get_next_gif_frame(int& frame, int& loop) const
+{
+    const int last{ static_cast<int>(m_GIFanim->frame_count) - 1 };
+
+    if (loop == m_GIFanim->loop_count && frame == last)
+        return false;
+
+    // Currently on the last frame, reset to first frame
+    if (frame == last)
+    {
+        // Only increment the loop counter if it's not looping forever.
+        if (m_GIFanim->loop_count > 0)
+            ++loop;
+        frame = 0;
+    }
+    else
+    {
+        ++frame;
+    }
+
+    return true;
+}
+
+// Does nothing if the decoder thread is already running
+void Image::start_gif_decoder()
+{
+    std::scoped_lock thread_lock{ m_GIFThreadMutex };
+    {
+        std::scoped_lock lock{ m_Mutex };
+        if (!m_Pixbuf || !m_GIFanim || m_GIFanim->frame_count <= 1 || m_GIFThread.joinable())
+            return;
+
+        // The decoder thread draws every frame in to frame_image
+        if (m_Pixbuf->get_pixels() == m_GIFanim->frame_image)
+            m_Pixbuf = m_Pixbuf->copy();
+
+        if (!m_GIFFrameStore)
         {
-            ++m_GIFcurFrame;
+            m_GIFFrameStore = std::make_unique<GIFFrameStore>(
+                m_GIFanim->width,
+                m_GIFanim->height,
+                static_cast<size_t>(std::max(Settings.get_int("GIFFrameMemory"), 0)) * 1024 *
+                    1024);
+
+            // The first frame is decoded by load_gif
+            if (m_GIFanim->decoded_frame == 0 &&
+                m_GIFFrameStore->add(0, static_cast<uint32_t*>(m_GIFanim->frame_image)))
+                m_GIFFrameStoreSize = m_GIFFrameStore->get_memory_size();
         }
     }
 
-    create_gif_frame_pixbuf();
+    m_GIFThread = std::thread([&]() { gif_decoder_thread(); });
+}
+
+void Image::stop_gif_decoder()
+{
+    std::scoped_lock lock{ m_GIFThreadMutex };
+    join_gif_decoder();
+}
 
-    return get_gif_finished_looping();
+// m_GIFThreadMutex must be held
+void Image::join_gif_decoder()
+{
+    {
+        std::scoped_lock lock{ m_GIFMutex };
+        m_GIFStop = true;
+    }
+    m_GIFCond.notify_all();
+
+    if (m_GIFThread.joinable())
+        m_GIFThread.join();
+
+    std::scoped_lock lock{ m_GIFMutex };
+    m_GIFFrames.clear();
+    m_GIFStop = false;
+}
+
+// Decodes up to GIFDecodeAhead frames after the current one, scaled to the size they
+// will be drawn at.  libnsgif is only used by this thread while it is running
+void Image::gif_decoder_thread()
+{
+    int frame, loop;
+    {
+        std::scoped_lock lock{ m_GIFMutex };
+        frame = m_GIFcurFrame;
+        loop  = m_GIFcurLoop;
+    }
+    std::vector<uint32_t> stored;
+
+    while (get_next_gif_frame(frame, loop))
+    {
+        int w, h;
+        {
+            std::unique_lock<std::mutex> lock{ m_GIFMutex };
+            m_GIFCond.wait(lock,
+                           [&]() { return m_GIFStop || m_GIFFrames.size() < GIFDecodeAhead; });
+            if (m_GIFStop)
+                return;
+
+            w = m_GIFFrameWidth;
+            h = m_GIFFrameHeight;
+        }
+
+        // Reading a truncated mapping would fault
+        if (!m_GIFData->is_intact())
+        {
+            std::cerr << "GIF " << m_Path << " was truncated while it was being played"
+                      << std::endl;
+            return;
+        }
+
+        // libnsgif draws each frame over the previous one, so the frames after a bad one
+        // would be wrong too.  The animation stays on the last good frame instead of
+        // retrying it every loop
+        const uint32_t* pixels{ decode_gif_frame(frame, stored) };
+        if (!pixels)
+            return;
+
+        auto frame_pixbuf{ Gdk::Pixbuf::create_from_data(
+            reinterpret_cast<const unsigned char*>(pixels),
+            Gdk::COLORSPACE_RGB,
+            true,
+            8,
+            m_GIFanim->width,
+            m_GIFanim->height,
+            m_GIFanim->width * 4) };
+        Glib::RefPtr<Gdk::Pixbuf> pixbuf;
+
+        if (w > 0 && h > 0 && (w != frame_pixbuf->get_width() || h != frame_pixbuf->get_height()))
+            pixbuf = Resampler::scale(frame_pixbuf, w, h, Settings.get_scaling_filter());
+        else
+            pixbuf = frame_pixbuf->copy();
+
+        std::scoped_lock lock{ m_GIFMutex };
+        if (m_GIFStop)
+            return;
+
+        m_GIFFrames.push_back({ pixbuf, frame, loop });
+    }
+}
+
+bool Image::is_animated_gif() const
+{
+    std::scoped_lock lock{ m_Mutex };
+    return m_GIFanim && m_GIFanim->frame_count > 1;
 }
 
 bool Image::get_gif_finished_looping() const
 {
+    std::scoped_lock lock{ m_Mutex };
     return m_GIFanim && m_GIFcurLoop == m_GIFanim->loop_count &&
            m_GIFcurFrame == static_cast<int>(m_GIFanim->frame_count) - 1;
 }
 
 unsigned int Image::get_gif_frame_delay() const
 {
+    std::scoped_lock lock{ m_Mutex };
     if (!m_GIFanim)
         return 0;
     int delay = m_GIFanim->frames[m_GIFcurFrame].frame_delay;
@@ -317,11 +820,62 @@ unsigned int Image::get_gif_frame_delay() const
     return delay ? delay * 10 : 100;
 }
 
+// Returns the frame's pixels, either copied from the frame store in to stored or decoded in
+// to frame_image.  Stored frames are never given back to libnsgif, its disposal handling
+// depends on the frames it decoded itself.  When it is not on the frame before this one
+// it decodes forward from where it is, or from the first frame after looping.  Once the
+// store is full this costs decoding the stored frames again, the same as without it
+const uint32_t* Image::decode_gif_frame(const int frame, std::vector<uint32_t>& stored)
+{
+    if (m_GIFFrameStore->has(frame))
+    {
+        stored.resize(static_cast<size_t>(m_GIFanim->width) * m_GIFanim->height);
+        m_GIFFrameStore->get(frame, stored.data());
+        return stored.data();
+    }
+
+    const int decoded{ m_GIFanim->decoded_frame };
+    for (int i = decoded >= 0 && decoded <= frame ? decoded + 1 : 0; i <= frame; ++i)
+    {
+        gif_result result{ gif_decode_frame(m_GIFanim, i) };
+        if (result != GIF_OK)
+        {
+            std::cerr << "Error while decoding GIF frame " << i << " of " << m_Path << std::endl
+                      << "gif_result: " << result << std::endl;
+            return nullptr;
+        }
+
+        if (m_GIFFrameStore->add(i, static_cast<uint32_t*>(m_GIFanim->frame_image)))
+            m_GIFFrameStoreSize = m_GIFFrameStore->get_memory_size();
+    }
+
+    return static_cast<uint32_t*>(m_GIFanim->frame_image);
+}
+
 void Image::reset_gif_animation()
 {
-    m_GIFcurFrame = 0;
-    m_GIFcurLoop  = 1;
+    std::scoped_lock thread_lock{ m_GIFThreadMutex };
+    join_gif_decoder();
+
+    {
+        std::scoped_lock lock{ m_GIFMutex };
+        m_GIFcurFrame = 0;
+        m_GIFcurLoop  = 1;
+    }
+
+    std::scoped_lock lock{ m_Mutex };
+    m_Scaled = false;
     m_Pixbuf.reset();
+    m_Mipmaps.clear();
+    m_FitPixbuf = {};
+
+    // Show the first frame from the frame store instead of loading the GIF again
+    if (m_GIFanim && m_GIFFrameStore && m_GIFFrameStore->has(0))
+    {
+        m_Pixbuf = Gdk::Pixbuf::create(
+            Gdk::COLORSPACE_RGB, true, 8, m_GIFanim->width, m_GIFanim->height);
+        m_GIFFrameStore->get(0, reinterpret_cast<uint32_t*>(m_Pixbuf->get_pixels()));
+    }
 }
 
 // This assumes data's length is at least 4
@@ -377,6 +931,50 @@ void Image::create_thumbnail(Glib::RefPtr<Gio::Cancellable> c, bool save)
         m_ThumbnailPixbuf = scale_pixbuf(pixbuf, ThumbnailSize, ThumbnailSize);
 }
 
+// Decodes the image at the fit size when it is larger than it.  The JPEG loader uses DCT
+// scaling for this so it is much faster than decoding the full image.
+// w and h are set to the full resolution size if the pixbuf was scaled, otherwise 0
+Glib::RefPtr<Gdk::Pixbuf> Image::create_fitted_pixbuf(const std::shared_ptr<ImageData>& data,
+                                                      Glib::RefPtr<Gio::Cancellable> c,
+                                                      int& w,
+                                                      int& h) const
+{
+    constexpr size_t ChunkSize{ 1024 * 1024 };
+    auto loader{ Gdk::PixbufLoader::create() };
+
+    // The loader reports the size from the image's header, before anything is decoded
+    w = h = 0;
+    loader->signal_size_prepared().connect([&](int width, int height) {
+        int fw{ width }, fh{ height };
+        if (!get_fit_size(fw, fh))
+            return;
+
+        w = width;
+        h = height;
+        loader->set_size(fw, fh);
+    });
+
+    // A failed write closes the loader and throws
+    const size_t size{ data->get_size() };
+    for (size_t offset = 0; offset < size && !c->is_cancelled(); offset += ChunkSize)
+        loader->write(data->get_data() + offset, std::min(ChunkSize, size - offset));
+
+    if (c->is_cancelled())
+    {
+        try
+        {
+            loader->close();
+        }
+        catch (const Glib::Error&)
+        {
+        }
+        return {};
+    }
+
+    loader->close();
+    return loader->get_pixbuf();
+}
+
 Glib::RefPtr<Gdk::Pixbuf> Image::create_pixbuf_at_size(const std::string& path,
                                                        const int w,
                                                        const int h,
@@ -405,9 +1003,10 @@ Image::scale_pixbuf(Glib::RefPtr<Gdk::Pixbuf>& pixbuf, const int w, const int h)
     double r = std::min(static_cast<double>(w) / pixbuf->get_width(),
                         static_cast<double>(h) / pixbuf->get_height());
 
-    return pixbuf->scale_simple(std::max(pixbuf->get_width() * r, 20.0),
-                                std::max(pixbuf->get_height() * r, 20.0),
-                                Gdk::INTERP_BILINEAR);
+    return Resampler::scale(pixbuf,
+                            std::max(pixbuf->get_width() * r, 20.0),
+                            std::max(pixbuf->get_height() * r, 20.0),
+                            Settings.get_scaling_filter());
 }
 
 // TODO: make this cancellable
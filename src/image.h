@@ -9,11 +9,17 @@ extern "C"
 }
 
 #include "config.h"
+#include "gifframestore.h"
+#include "imagedata.h"
 #include "util.h"
 
 #include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
 #include <mutex>
 #include <thread>
+#include <vector>
 
 #ifdef HAVE_GSTREAMER
 #include <gst/gst.h>
@@ -24,6 +30,22 @@ namespace AhoViewer
     class Image
     {
     public:
+        // A scaled copy of a pixbuf, and what it was scaled from
+        struct ScaledPixbuf
+        {
+            Glib::RefPtr<Gdk::Pixbuf> source, pixbuf;
+            int width{ 0 }, height{ 0 };
+            ScalingFilter filter{ ScalingFilter::BILINEAR };
+
+            bool matches(const Glib::RefPtr<Gdk::Pixbuf>& s,
+                         const int w,
+                         const int h,
+                         const ScalingFilter f) const
+            {
+                return pixbuf && source == s && width == w && height == h && filter == f;
+            }
+        };
+
         Image(std::string path);
         virtual ~Image();
 
@@ -31,9 +53,18 @@ namespace AhoViewer
         static bool is_valid_extension(const std::string& path);
         static const Glib::RefPtr<Gdk::Pixbuf>& get_missing_pixbuf();
 
+        // Sets the area the ImageBox fits images to, when DecodeAtFitSize is enabled
+        // images larger than it are decoded at the size they will be drawn at.
+        // Returns true if the area or zoom mode changed
+        static bool set_fit_size(const int w, const int h, const ZoomMode zoom_mode);
+        // Sets w and h to the size an image of w x h is drawn at when fit to ww x wh.
+        // Returns false if the image is not scaled down, or zoom_mode is manual
+        static bool
+        fit_to_area(int& w, int& h, const int ww, const int wh, const ZoomMode zoom_mode);
+
         const std::string get_path() const { return m_Path; }
         bool is_webm() const { return m_IsWebM; }
-        bool is_animated_gif() const { return m_GIFanim && m_GIFanim->frame_count > 1; }
+        bool is_animated_gif() const;
 
         // This is used to let the imagebox know that load_pixbuf has been or needs to be
         // called but has not yet finished loading.  When the image has finished loading
@@ -44,58 +75,142 @@ namespace AhoViewer
         virtual const Glib::RefPtr<Gdk::Pixbuf>& get_pixbuf();
         virtual const Glib::RefPtr<Gdk::Pixbuf>& get_thumbnail(Glib::RefPtr<Gio::Cancellable> c);
 
+        // The thumbnail ImageList::Widget shows for this image, it is only set by the GUI
+        // thread once the widget is updated
+        const Glib::RefPtr<Gdk::Pixbuf>& get_widget_thumbnail() const { return m_WidgetThumbnail; }
+        void set_widget_thumbnail(const Glib::RefPtr<Gdk::Pixbuf>& p) { m_WidgetThumbnail = p; }
+
         const std::vector<Note>& get_notes() const { return m_Notes; }
 
         virtual void load_pixbuf(Glib::RefPtr<Gio::Cancellable> c);
         virtual void reset_pixbuf();
-
+        void reload_pixbuf(Glib::RefPtr<Gio::Cancellable> c);
+
+        // Full resolution size of the image, the pixbuf is smaller than this when is_scaled
+        void get_size(int& w, int& h);
+        bool is_scaled() const { return m_Scaled; }
+
+        // Each mipmap level is half the size of the previous one, starting from the pixbuf.
+        // get_mipmap returns the smallest level that is at least w x h
+        void build_mipmaps(Glib::RefPtr<Gio::Cancellable> c);
+        bool has_mipmaps();
+        Glib::RefPtr<Gdk::Pixbuf> get_mipmap(const int w, const int h);
+
+        // The pixbuf scaled to the size it will be drawn at in the current fit area.
+        // The cache threads create this for the images next to the current one so they
+        // can be shown without scaling them first
+        void create_fit_pixbuf(Glib::RefPtr<Gio::Cancellable> c);
+        ScaledPixbuf get_fit_pixbuf();
+        void reset_fit_pixbuf();
+
+        // Number of bytes used by the decoded pixbuf, its mipmaps and fit pixbuf, or the GIF
+        // data and frame buffers
+        size_t get_memory_size();
+
+        // Shows the next frame decoded by the GIF decoder thread, the thread is started
+        // by the first call to this or set_gif_frame_size
         bool gif_advance_frame();
         bool get_gif_finished_looping() const;
         unsigned int get_gif_frame_delay() const;
         void reset_gif_animation();
+        // Size the decoder thread scales frames to, this is the size the ImageBox draws
+        // the animation at
+        void set_gif_frame_size(const int w, const int h);
 
         Glib::Dispatcher& signal_pixbuf_changed() { return m_SignalPixbufChanged; }
         Glib::Dispatcher& signal_notes_changed() { return m_SignalNotesChanged; }
 
         static const size_t ThumbnailSize{ 100 };
+        // Mipmap levels are not built smaller than this
+        static const int MinMipmapSize{ 128 };
 
     protected:
+        // A frame decoded ahead of time by the GIF decoder thread
+        struct GIFFrame
+        {
+            Glib::RefPtr<Gdk::Pixbuf> pixbuf;
+            int frame, loop;
+        };
+
         static bool is_webm(const std::string&);
 
-        void load_gif();
-        void create_gif_frame_pixbuf();
+        void load_gif(std::shared_ptr<ImageData> data);
         bool is_gif(const unsigned char* data);
         void create_thumbnail(Glib::RefPtr<Gio::Cancellable> c, bool save = true);
+        Glib::RefPtr<Gdk::Pixbuf> create_fitted_pixbuf(const std::shared_ptr<ImageData>& data,
+                                                       Glib::RefPtr<Gio::Cancellable> c,
+                                                       int& w,
+                                                       int& h) const;
         Glib::RefPtr<Gdk::Pixbuf> create_pixbuf_at_size(const std::string& path,
                                                         const int w,
                                                         const int h,
                                                         Glib::RefPtr<Gio::Cancellable> c) const;
 
         bool m_IsWebM;
-        std::atomic<bool> m_Loading{ true };
+        std::atomic<bool> m_Loading{ true }, m_Scaled{ false };
+        // Full resolution size when m_Scaled is true
+        int m_Width{ 0 }, m_Height{ 0 };
         std::string m_Path, m_ThumbnailPath;
 
-        Glib::RefPtr<Gdk::Pixbuf> m_ThumbnailPixbuf;
+        Glib::RefPtr<Gdk::Pixbuf> m_ThumbnailPixbuf, m_WidgetThumbnail;
         Glib::RefPtr<Gdk::Pixbuf> m_Pixbuf;
+        // Built from m_Pixbuf, they are cleared whenever m_Pixbuf changes
+        std::vector<Glib::RefPtr<Gdk::Pixbuf>> m_Mipmaps;
+        // Only kept while its source is still m_Pixbuf
+        ScaledPixbuf m_FitPixbuf;
 
+        // Replaced by load_gif with m_Mutex held, the GUI thread reads it with it held
         gif_animation* m_GIFanim{ nullptr };
-        size_t m_GIFdataSize{ 0 };
-        unsigned char* m_GIFdata{ nullptr };
+        // libnsgif reads straight from this, it must outlive m_GIFanim
+        std::shared_ptr<ImageData> m_GIFData;
         gif_bitmap_callback_vt m_BitmapCallbacks;
         int m_GIFcurFrame{ 0 }, m_GIFcurLoop{ 1 };
 
+        // Frames the decoder thread has decoded after m_GIFcurFrame, m_GIFcurFrame and
+        // m_GIFcurLoop are only changed by the GUI thread with m_GIFMutex held
+        std::deque<GIFFrame> m_GIFFrames;
+        int m_GIFFrameWidth{ 0 }, m_GIFFrameHeight{ 0 };
+        // Frames that have been decoded once, so looping doesn't need libnsgif.
+        // Only used by the decoder thread while it is running
+        std::unique_ptr<GIFFrameStore> m_GIFFrameStore;
+        // The frame store's size as of its last add, so get_memory_size can be called
+        // from other threads without touching the store
+        std::atomic<size_t> m_GIFFrameStoreSize{ 0 };
+        bool m_GIFStop{ false };
+        // Starting and stopping m_GIFThread can happen on different threads, this guards
+        // it and is held by anything that replaces or frees m_GIFanim
+        std::thread m_GIFThread;
+        std::mutex m_GIFThreadMutex, m_GIFMutex;
+        std::condition_variable m_GIFCond;
+
         std::vector<Note> m_Notes;
 
-        std::mutex m_Mutex;
+        mutable std::mutex m_Mutex;
         Glib::Dispatcher m_SignalPixbufChanged, m_SignalNotesChanged;
 
     private:
+        static bool get_fit_size(int& w, int& h);
+        static bool get_fit_area(int& ww, int& wh, ZoomMode& zoom_mode);
+
         Glib::RefPtr<Gdk::Pixbuf>
         scale_pixbuf(Glib::RefPtr<Gdk::Pixbuf>& pixbuf, const int w, const int h) const;
 
+        bool get_next_gif_frame(int& frame, int& loop) const;
+        void start_gif_decoder();
+        void stop_gif_decoder();
+        void join_gif_decoder();
+        void gif_decoder_thread();
+        const uint32_t* decode_gif_frame(const int frame, std::vector<uint32_t>& stored);
+
         Glib::RefPtr<Gdk::Pixbuf> create_webm_thumbnail(int w, int h) const;
         void save_thumbnail(Glib::RefPtr<Gdk::Pixbuf>& pixbuf, const gchar* mime_type) const;
 
         static const std::string ThumbnailDir;
+        // Number of frames the GIF decoder thread decodes ahead of the current one
+        static const size_t GIFDecodeAhead{ 8 };
+
+        static std::mutex FitSizeMutex;
+        static int FitWidth, FitHeight;
+        static ZoomMode FitZoomMode;
     };
 }
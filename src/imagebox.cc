@@ -3,6 +3,7 @@ using namespace AhoViewer;
 
 #include "imageboxnote.h"
 #include "mainwindow.h"
+#include "resampler.h"
 #include "settings.h"
 #include "statusbar.h"
 
@@ -82,7 +83,9 @@ ImageBox::ImageBox(BaseObjectType* cobj, const Glib::RefPtr<Gtk::Builder>& bldr)
       m_FleurCursor{ Gdk::Cursor::create(Gdk::FLEUR) },
       m_BlankCursor{ Gdk::Cursor::create(Gdk::BLANK_CURSOR) },
       m_ZoomMode{ Settings.get_zoom_mode() },
-      m_RestoreScrollPos{ -1, -1, m_ZoomMode }
+      m_RestoreScrollPos{ -1, -1, m_ZoomMode },
+      m_ScaleCancel{ Gio::Cancellable::create() },
+      m_ImageTaskCancel{ Gio::Cancellable::create() }
 {
     bldr->get_widget("ImageBox::Layout", m_Layout);
     bldr->get_widget("ImageBox::Overlay", m_Overlay);
@@ -200,6 +203,24 @@ ImageBox::ImageBox(BaseObjectType* cobj, const Glib::RefPtr<Gtk::Builder>& bldr)
     g_object_unref(bus);
 #endif // HAVE_GSTREAMER
 
+    // Draw the visible tiles instead of the image when the tile cache is in use
+    m_GtkImage->signal_draw().connect(
+        [&](const Cairo::RefPtr<Cairo::Context>& cr) {
+            if (m_TileCache.empty())
+                return false;
+
+            const Gdk::Rectangle a{ m_Overlay->get_allocation() };
+            m_TileCache.draw(cr,
+                             { static_cast<int>(get_hadjustment()->get_value()) - a.get_x(),
+                               static_cast<int>(get_vadjustment()->get_value()) - a.get_y(),
+                               static_cast<int>(get_hadjustment()->get_page_size()),
+                               static_cast<int>(get_vadjustment()->get_page_size()) });
+            return true;
+        },
+        false);
+    m_TileCache.signal_tiles_ready().connect([&]() { m_GtkImage->queue_draw(); });
+    m_SignalScaled.connect(sigc::mem_fun(*this, &ImageBox::on_scale_task_finished));
+
     m_StyleUpdatedConn = m_Layout->signal_style_updated().connect(
         [&]() { m_Layout->get_style_context()->lookup_color("theme_bg_color", DefaultBGColor); });
 }
@@ -210,6 +231,10 @@ ImageBox::~ImageBox()
 #ifdef HAVE_GSTREAMER
     gst_object_unref(GST_OBJECT(m_Playbin));
 #endif // HAVE_GSTREAMER
+
+    // Cancelled tasks are left to finish on their own, they still use this
+    std::unique_lock<std::mutex> lock{ m_TaskMutex };
+    m_TaskCond.wait(lock, [&]() { return m_TaskCount == 0; });
 }
 
 void ImageBox::queue_draw_image(const bool scroll)
@@ -224,6 +249,23 @@ void ImageBox::queue_draw_image(const bool scroll)
         Glib::PRIORITY_HIGH_IDLE);
 }
 
+void ImageBox::queue_draw_image_fast()
+{
+    m_FastDraw = true;
+
+    m_FastDrawConn.disconnect();
+    m_FastDrawConn = Glib::signal_timeout().connect(
+        [&]() {
+            m_FastDraw   = false;
+            m_ScaleAsync = true;
+            queue_draw_image();
+            return false;
+        },
+        FastDrawSettleDelay);
+
+    queue_draw_image();
+}
+
 void ImageBox::set_image(const std::shared_ptr<Image>& image)
 {
     if (!image)
@@ -236,6 +278,9 @@ void ImageBox::set_image(const std::shared_ptr<Image>& image)
         m_NotesConn.disconnect();
         reset_slideshow();
         clear_notes();
+        cancel_image_task();
+        cancel_scale_task();
+        m_ScaleAsync = false;
 
 #ifdef HAVE_GSTREAMER
         reset_gstreamer_pipeline();
@@ -273,12 +318,19 @@ void ImageBox::clear_image()
     m_NotesConn.disconnect();
     m_DrawConn.disconnect();
     m_AnimConn.disconnect();
+    m_FastDrawConn.disconnect();
+    m_FastDraw = m_ScaleAsync = false;
     m_GtkImage->clear();
+    m_GtkImage->set_size_request(-1, -1);
+    m_TileCache.clear();
+    m_ScaledPixbuf = {};
     m_Overlay->hide();
     m_DrawingArea->hide();
     m_Layout->set_size(0, 0);
 
     clear_notes();
+    cancel_image_task();
+    cancel_scale_task();
 
 #ifdef HAVE_GSTREAMER
     reset_gstreamer_pipeline();
@@ -288,6 +340,157 @@ void ImageBox::clear_image()
     m_Image = nullptr;
 }
 
+// Runs func on a background thread with the current image, the image's pixbuf_changed
+// signal will queue a redraw once it is done.  Only one task runs at a time,
+// if one is already running func is dropped and will be started by a later draw
+void ImageBox::start_image_task(
+    const std::function<void(Glib::RefPtr<Gio::Cancellable>)>& func)
+{
+    {
+        std::scoped_lock lock{ m_TaskMutex };
+        if (m_ImageTaskRunning)
+            return;
+
+        m_ImageTaskRunning = true;
+        ++m_TaskCount;
+    }
+
+    m_ImageTaskCancel = Gio::Cancellable::create();
+    std::thread([&, func, c = m_ImageTaskCancel, generation = m_ImageTaskGeneration]() {
+        func(c);
+
+        std::scoped_lock lock{ m_TaskMutex };
+        // A newer task may have started since this one was cancelled
+        if (generation == m_ImageTaskGeneration)
+            m_ImageTaskRunning = false;
+        --m_TaskCount;
+        m_TaskCond.notify_all();
+    }).detach();
+}
+
+// The task is not waited for, it stops on its own once it sees the cancellable
+void ImageBox::cancel_image_task()
+{
+    m_ImageTaskCancel->cancel();
+
+    std::scoped_lock lock{ m_TaskMutex };
+    ++m_ImageTaskGeneration;
+    m_ImageTaskRunning = false;
+}
+
+// Returns pixbuf scaled to w x h, reusing the last result or the one the cache threads
+// made ahead of time when nothing has changed.
+// A new pixbuf is set whenever the image changes, reloads or advances a GIF frame
+Glib::RefPtr<Gdk::Pixbuf>
+ImageBox::get_scaled_pixbuf(const Glib::RefPtr<Gdk::Pixbuf>& pixbuf, const int w, const int h)
+{
+    const ScalingFilter filter{ Settings.get_scaling_filter() };
+
+    if (m_ScaledPixbuf.matches(pixbuf, w, h, filter))
+    {
+        m_ScaleAsync = false;
+        return m_ScaledPixbuf.pixbuf;
+    }
+
+    if (m_Image->get_fit_pixbuf().matches(pixbuf, w, h, filter))
+    {
+        m_ScaleAsync   = false;
+        m_ScaledPixbuf = m_Image->get_fit_pixbuf();
+        return m_ScaledPixbuf.pixbuf;
+    }
+
+    // Scale from the smallest mipmap level that is still larger than the target size
+    if (!m_FastDraw && !m_ScaleAsync)
+    {
+        m_ScaledPixbuf = {
+            pixbuf, Resampler::scale(m_Image->get_mipmap(w, h), w, h, filter), w, h, filter
+        };
+        return m_ScaledPixbuf.pixbuf;
+    }
+
+    if (m_ScaleAsync)
+        start_scale_task(pixbuf, w, h, filter);
+
+    // Nearest neighbour from a mipmap is fast enough to keep up with resizing,
+    // it is not kept since it will be replaced once the scale thread finishes
+    return m_Image->get_mipmap(w, h)->scale_simple(w, h, Gdk::INTERP_NEAREST);
+}
+
+void ImageBox::start_scale_task(const Glib::RefPtr<Gdk::Pixbuf>& pixbuf,
+                                const int w,
+                                const int h,
+                                const ScalingFilter filter)
+{
+    // Already scaling it
+    if (m_ScaleRequest.source == pixbuf && m_ScaleRequest.width == w &&
+        m_ScaleRequest.height == h && m_ScaleRequest.filter == filter)
+        return;
+
+    cancel_scale_task();
+
+    {
+        std::scoped_lock lock{ m_TaskMutex };
+        ++m_TaskCount;
+    }
+
+    m_ScaleRequest = { pixbuf, nullptr, w, h, filter };
+    m_ScaleCancel  = Gio::Cancellable::create();
+    std::thread([&,
+                 source     = m_Image->get_mipmap(w, h),
+                 req        = m_ScaleRequest,
+                 c          = m_ScaleCancel,
+                 generation = m_ScaleGeneration]() {
+        auto scaled{ Resampler::scale(source, req.width, req.height, req.filter) };
+
+        if (!c->is_cancelled())
+        {
+            {
+                std::scoped_lock lock{ m_ScaleMutex };
+                m_ScaleResult           = req;
+                m_ScaleResult.pixbuf    = scaled;
+                m_ScaleResultGeneration = generation;
+            }
+
+            m_SignalScaled();
+        }
+
+        std::scoped_lock lock{ m_TaskMutex };
+        --m_TaskCount;
+        m_TaskCond.notify_all();
+    }).detach();
+}
+
+// The task is not waited for, on_scale_task_finished drops its result if it finishes
+// before it sees the cancellable
+void ImageBox::cancel_scale_task()
+{
+    m_ScaleCancel->cancel();
+    ++m_ScaleGeneration;
+    m_ScaleRequest = {};
+
+    std::scoped_lock lock{ m_ScaleMutex };
+    m_ScaleResult = {};
+}
+
+void ImageBox::on_scale_task_finished()
+{
+    {
+        std::scoped_lock lock{ m_ScaleMutex };
+        if (!m_ScaleResult.pixbuf || m_ScaleResultGeneration != m_ScaleGeneration)
+            return;
+
+        m_ScaledPixbuf = std::move(m_ScaleResult);
+        m_ScaleResult  = {};
+    }
+
+    m_ScaleRequest = {};
+
+    // If the size changed again since this was started, the next draw will either
+    // draw fast again or scale it on the GUI thread
+    m_ScaleAsync = false;
+    queue_draw_image();
+}
+
 void ImageBox::update_background_color()
 {
     auto css = Gtk::CssProvider::create();
@@ -533,27 +736,16 @@ void ImageBox::get_scale_and_position(int& w, int& h, int& x, int& y)
     w = m_OrigWidth;
     h = m_OrigHeight;
 
-    double window_aspect = static_cast<double>(ww) / wh, image_aspect = static_cast<double>(w) / h;
-
-    // These do not take the scrollbar size in to account, because I assume that
-    // overlay scrollbars are enabled
-    if (w > ww && (m_ZoomMode == ZoomMode::FIT_WIDTH ||
-                   (m_ZoomMode == ZoomMode::AUTO_FIT && window_aspect <= image_aspect)))
-    {
-        w = ww;
-        h = std::ceil(w / image_aspect);
-    }
-    else if (h > wh && (m_ZoomMode == ZoomMode::FIT_HEIGHT ||
-                        (m_ZoomMode == ZoomMode::AUTO_FIT && window_aspect >= image_aspect)))
-    {
-        h = wh;
-        w = std::ceil(h * image_aspect);
-    }
-    else if (m_ZoomMode == ZoomMode::MANUAL && m_ZoomPercent != 100)
+    if (m_ZoomMode == ZoomMode::MANUAL && m_ZoomPercent != 100)
     {
         w *= static_cast<double>(m_ZoomPercent) / 100;
         h *= static_cast<double>(m_ZoomPercent) / 100;
     }
+    // The cache threads use the same sizes to scale images ahead of time
+    else
+    {
+        Image::fit_to_area(w, h, ww, wh, m_ZoomMode);
+    }
 
     x = std::max(0, (ww - w) / 2);
     y = std::max(0, (wh - h) / 2);
@@ -574,9 +766,15 @@ void ImageBox::draw_image(bool scroll)
     }
 
     // Temporary pixbuf used when scaling is needed
-    Glib::RefPtr<Gdk::Pixbuf> temp_pixbuf;
+    Glib::RefPtr<Gdk::Pixbuf> pixbuf, temp_pixbuf;
     bool error{ false };
 
+    // Let the cache decode large images at the size they will be drawn
+    int ww, wh;
+    m_MainWindow->get_drawable_area_size(ww, wh);
+    if (Image::set_fit_size(ww, wh, m_ZoomMode))
+        m_SignalFitSizeChanged();
+
     // if the image is still loading we want to draw all requests
     // Only booru images will do this
     m_Loading = m_Image->is_loading();
@@ -628,15 +826,15 @@ void ImageBox::draw_image(bool scroll)
                     m_Image->get_gif_frame_delay());
         }
 
-        Glib::RefPtr<Gdk::Pixbuf> pixbuf = m_Image->get_pixbuf();
+        pixbuf = m_Image->get_pixbuf();
 
         if (pixbuf)
         {
             // Set this here incase we dont need to scale
             temp_pixbuf = pixbuf;
 
-            m_OrigWidth  = pixbuf->get_width();
-            m_OrigHeight = pixbuf->get_height();
+            // The pixbuf may have been decoded smaller than the full resolution
+            m_Image->get_size(m_OrigWidth, m_OrigHeight);
         }
         else
         {
@@ -655,8 +853,35 @@ void ImageBox::draw_image(bool scroll)
     get_scale_and_position(w, h, x, y);
     m_Scale =
         m_ZoomMode == ZoomMode::MANUAL ? m_ZoomPercent : static_cast<double>(w) / m_OrigWidth * 100;
-    if (!m_Image->is_webm() && !error && (w != m_OrigWidth || h != m_OrigHeight))
-        temp_pixbuf = m_Image->get_pixbuf()->scale_simple(w, h, Gdk::INTERP_BILINEAR);
+    // Only the visible part of very large zoomed in images is scaled
+    const bool tiled{ !m_Image->is_webm() && !error && !m_Image->is_animated_gif() &&
+                      m_ZoomMode == ZoomMode::MANUAL &&
+                      static_cast<int64_t>(w) * h >
+                          static_cast<int64_t>(ww) * wh * TiledRenderThreshold };
+
+    if (!m_Image->is_webm() && !error)
+    {
+        // Have the decoder thread scale the frames so they can be drawn as they are
+        if (m_Image->is_animated_gif())
+            m_Image->set_gif_frame_size(w, h);
+
+        if (tiled)
+            m_TileCache.set_source(pixbuf, w, h, Settings.get_scaling_filter());
+        else if (w != pixbuf->get_width() || h != pixbuf->get_height())
+            temp_pixbuf = get_scaled_pixbuf(pixbuf, w, h);
+
+        // Neither of these are started until the size stops changing.
+        // Scaling a scaled down pixbuf back up loses detail, draw it anyway until
+        // it has been decoded at a larger size.  Allow for the fit size being rounded
+        if (!m_FastDraw && m_Image->is_scaled() && !m_Image->is_animated_gif() &&
+            (w > pixbuf->get_width() + 1 || h > pixbuf->get_height() + 1))
+            start_image_task([image = m_Image](auto c) { image->reload_pixbuf(c); });
+        // Mipmaps are only worth building once the image is drawn at half its size or less
+        else if (!m_FastDraw && !m_Loading && !m_Image->is_animated_gif() &&
+                 w * 2 <= pixbuf->get_width() && h * 2 <= pixbuf->get_height() &&
+                 !m_Image->has_mipmaps())
+            start_image_task([image = m_Image](auto c) { image->build_mipmaps(c); });
+    }
 
     double h_adjust_val{ 0 }, v_adjust_val{ 0 };
 
@@ -675,8 +900,20 @@ void ImageBox::draw_image(bool scroll)
 
     m_Layout->set_size(w, h);
 
-    if (temp_pixbuf)
+    if (tiled)
+    {
+        m_ScaledPixbuf = {};
+        m_Layout->move(*m_Overlay, x, y);
+        m_GtkImage->clear();
+        m_GtkImage->set_size_request(w, h);
+        m_Overlay->show();
+        m_GtkImage->queue_draw();
+    }
+    else if (temp_pixbuf)
     {
+        m_TileCache.clear();
+        m_GtkImage->set_size_request(-1, -1);
+
         m_Layout->move(*m_Overlay, x, y);
         m_GtkImage->set(temp_pixbuf);
         m_Overlay->show();
@@ -687,6 +924,8 @@ void ImageBox::draw_image(bool scroll)
         if (!m_Playing)
         {
             m_GtkImage->clear();
+            m_GtkImage->set_size_request(-1, -1);
+            m_TileCache.clear();
             m_Overlay->hide();
             m_DrawingArea->show();
         }
@@ -899,7 +1138,7 @@ void ImageBox::zoom(const std::uint32_t percent)
 
     m_ZoomScroll  = m_ZoomPercent != percent;
     m_ZoomPercent = percent;
-    queue_draw_image();
+    queue_draw_image_fast();
 }
 
 bool ImageBox::advance_slideshow()
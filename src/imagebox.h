@@ -2,6 +2,7 @@
 
 #include "config.h"
 #include "image.h"
+#include "tilecache.h"
 #include "util.h"
 
 #include <gtkmm.h>
@@ -22,6 +23,10 @@ namespace AhoViewer
         ~ImageBox() override;
 
         void queue_draw_image(const bool scroll = false);
+        // Used while the window is being resized or the image zoomed.  The image is drawn
+        // with a fast filter until the size stops changing, then scaled with the scaling
+        // filter in the background
+        void queue_draw_image_fast();
         void set_image(const std::shared_ptr<Image>& image);
         void clear_image();
         void update_background_color();
@@ -48,6 +53,8 @@ namespace AhoViewer
 
         sigc::signal<void> signal_slideshow_ended() const { return m_SignalSlideshowEnded; }
         sigc::signal<void> signal_image_drawn() const { return m_SignalImageDrawn; }
+        // Emitted when the area images are fit to or the zoom mode changes
+        sigc::signal<void> signal_fit_size_changed() const { return m_SignalFitSizeChanged; }
 
         static Gdk::RGBA DefaultBGColor;
 
@@ -78,6 +85,16 @@ namespace AhoViewer
         void smooth_scroll(const int, const Glib::RefPtr<Gtk::Adjustment>&);
         bool update_smooth_scroll();
         void zoom(const uint32_t percent);
+        void start_image_task(const std::function<void(Glib::RefPtr<Gio::Cancellable>)>& func);
+        void cancel_image_task();
+        Glib::RefPtr<Gdk::Pixbuf>
+        get_scaled_pixbuf(const Glib::RefPtr<Gdk::Pixbuf>& pixbuf, const int w, const int h);
+        void start_scale_task(const Glib::RefPtr<Gdk::Pixbuf>& pixbuf,
+                              const int w,
+                              const int h,
+                              const ScalingFilter filter);
+        void cancel_scale_task();
+        void on_scale_task_finished();
 
         bool advance_slideshow();
         bool on_cursor_timeout();
@@ -86,6 +103,10 @@ namespace AhoViewer
         void update_notes();
 
         static constexpr double SmoothScrollStep = 1000.0 / 60.0;
+        // Zoomed images larger than this many times the drawable area are drawn in tiles
+        static constexpr int TiledRenderThreshold = 4;
+        // Milliseconds the size has to stay the same before the fast draw is replaced
+        static constexpr unsigned int FastDrawSettleDelay = 150;
 
         Gtk::Layout *m_Layout, *m_NoteLayout;
         Gtk::Overlay* m_Overlay;
@@ -131,6 +152,36 @@ namespace AhoViewer
 
         std::vector<ImageBoxNote*> m_Notes;
 
-        sigc::signal<void> m_SignalSlideshowEnded, m_SignalImageDrawn;
+        TileCache m_TileCache;
+
+        // The last scaled pixbuf, redraws that don't change the source pixbuf, size or
+        // filter reuse it instead of scaling again
+        Image::ScaledPixbuf m_ScaledPixbuf;
+
+        // m_FastDraw is set while the size is changing, once it settles m_ScaleAsync is set
+        // so the next draw scales the image on m_ScaleThread instead of the GUI thread
+        bool m_FastDraw{ false }, m_ScaleAsync{ false };
+        sigc::connection m_FastDrawConn;
+        // What the scale thread is scaling, the result is stored with m_ScaleMutex held.
+        // Cancelling bumps m_ScaleGeneration so results of older threads are dropped
+        Image::ScaledPixbuf m_ScaleRequest, m_ScaleResult;
+        unsigned int m_ScaleGeneration{ 0 }, m_ScaleResultGeneration{ 0 };
+        Glib::RefPtr<Gio::Cancellable> m_ScaleCancel;
+        std::mutex m_ScaleMutex;
+        Glib::Dispatcher m_SignalScaled;
+
+        // Runs work on the current image in the background, such as decoding scaled images
+        // again when they need to be drawn larger, or building mipmaps
+        Glib::RefPtr<Gio::Cancellable> m_ImageTaskCancel;
+        unsigned int m_ImageTaskGeneration{ 0 };
+        bool m_ImageTaskRunning{ false };
+
+        // The scale and image task threads are detached, the destructor waits for
+        // m_TaskCount to reach 0.  Guards it and the image task members above
+        std::mutex m_TaskMutex;
+        std::condition_variable m_TaskCond;
+        size_t m_TaskCount{ 0 };
+
+        sigc::signal<void> m_SignalSlideshowEnded, m_SignalImageDrawn, m_SignalFitSizeChanged;
     };
 }
@@ -0,0 +1,59 @@
+#include "imagedata.h"
+using namespace AhoViewer;
+
+#include <glib/gstdio.h>
+
+std::shared_ptr<ImageData> ImageData::create_from_file(const std::string& path)
+{
+    GError* error{ nullptr };
+    GMappedFile* file{ g_mapped_file_new(path.c_str(), false, &error) };
+
+    if (!file)
+        throw Glib::FileError(error);
+
+    // The bytes hold a reference to the mapping
+    GBytes* bytes{ g_mapped_file_get_bytes(file) };
+    g_mapped_file_unref(file);
+
+    return std::shared_ptr<ImageData>(new ImageData(bytes, path));
+}
+
+std::shared_ptr<ImageData> ImageData::create_from_buffer(std::vector<unsigned char>&& buffer)
+{
+    using Buffer = std::vector<unsigned char>;
+
+    auto* v{ new Buffer(std::move(buffer)) };
+    GBytes* bytes{ g_bytes_new_with_free_func(
+        v->data(), v->size(), [](void* p) { delete static_cast<Buffer*>(p); }, v) };
+
+    return std::shared_ptr<ImageData>(new ImageData(bytes, ""));
+}
+
+ImageData::ImageData(GBytes* bytes, const std::string& path)
+    : m_Bytes{ Glib::wrap(bytes) },
+      m_Path{ path }
+{
+    gsize size;
+    m_Data = static_cast<const unsigned char*>(g_bytes_get_data(bytes, &size));
+    m_Size = size;
+}
+
+bool ImageData::is_intact() const
+{
+    if (m_Path.empty())
+        return true;
+
+    // A deleted file stays mapped.  A smaller file that replaced it is treated as if it
+    // was truncated, the mapping can't be told apart from it by path
+    GStatBuf file_info;
+    return g_stat(m_Path.c_str(), &file_info) != 0 ||
+           static_cast<size_t>(file_info.st_size) >= m_Size;
+}
+
+Glib::RefPtr<Gio::InputStream> ImageData::create_stream() const
+{
+    auto stream{ Gio::MemoryInputStream::create() };
+    stream->add_bytes(m_Bytes);
+
+    return stream;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <giomm.h>
+#include <glibmm.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace AhoViewer
+{
+    // Read only contents of an image file that the decoders read from directly.
+    // Local files are memory mapped and downloaded buffers are adopted, so neither
+    // is copied in to a second buffer.  Files are mapped privately, but reading past the
+    // end of a file that was truncated after it was mapped still faults, so readers that
+    // keep the data should check is_intact() before each read
+    class ImageData
+    {
+    public:
+        // Throws Glib::FileError if the file cannot be mapped
+        static std::shared_ptr<ImageData> create_from_file(const std::string& path);
+        static std::shared_ptr<ImageData> create_from_buffer(std::vector<unsigned char>&& buffer);
+
+        const unsigned char* get_data() const { return m_Data; }
+        size_t get_size() const { return m_Size; }
+        // Mapped files are backed by the page cache instead of the heap
+        bool is_mapped() const { return !m_Path.empty(); }
+        // Returns false if the mapped file is now smaller than the mapping
+        bool is_intact() const;
+
+        Glib::RefPtr<Glib::Bytes> get_bytes() const { return m_Bytes; }
+        // A stream over the data for the GdkPixbuf loaders
+        Glib::RefPtr<Gio::InputStream> create_stream() const;
+
+    private:
+        ImageData(GBytes* bytes, const std::string& path);
+
+        Glib::RefPtr<Glib::Bytes> m_Bytes;
+        const unsigned char* m_Data{ nullptr };
+        size_t m_Size{ 0 };
+        // Empty unless the data is a mapped file
+        const std::string m_Path;
+    };
+}
@@ -5,54 +5,64 @@ using namespace AhoViewer;
 #include "naturalsort.h"
 #include "settings.h"
 
-#include <numeric>
+#include <iostream>
 #include <thread>
+#include <utility>
+
+std::atomic<size_t> ImageList::TotalCacheMemorySize{ 0 };
+
+// Returns the CacheMemory setting in bytes
+static size_t get_cache_memory_limit()
+{
+    return static_cast<size_t>(std::max(Settings.get_int("CacheMemory"), 0)) * 1024 * 1024;
+}
 
 ImageList::ImageList(Widget* const w)
     : m_Widget{ w },
       m_ScrollPos{ -1, -1, ZoomMode::AUTO_FIT },
-      m_ThumbnailCancel{ Gio::Cancellable::create() },
-      m_CacheCancel{ Gio::Cancellable::create() }
+      m_ThumbnailCancel{ Gio::Cancellable::create() }
 {
-    // Sorts indices based on how close they are to m_Index
-    m_IndexSort = [=](size_t a, size_t b) {
-        size_t adiff = std::abs(static_cast<int>(a - m_Index)),
-               bdiff = std::abs(static_cast<int>(b - m_Index));
-        return adiff == bdiff ? a > b : adiff < bdiff;
-    };
+    m_Widget->m_Model->set_images(&m_Images);
 
     m_Widget->signal_selected_changed().connect(
         sigc::bind(sigc::mem_fun(*this, &ImageList::set_current), true, false));
+    m_Widget->signal_visible_range_changed().connect(
+        sigc::mem_fun(*this, &ImageList::on_visible_range_changed));
 
     m_ThumbnailLoadedConn =
         m_SignalThumbnailLoaded.connect(sigc::mem_fun(*this, &ImageList::on_thumbnail_loaded));
-
-    m_CacheThread = std::thread([&]() {
-        while (!m_CacheStop)
-        {
-            {
-                std::unique_lock<std::mutex> lock(m_CacheMutex);
-                m_CacheCond.wait(
-                    lock, [&]() { return !m_CacheQueue.empty() || m_CacheCancel->is_cancelled(); });
-            }
-
-            std::shared_ptr<Image> img = nullptr;
-            while (!m_CacheCancel->is_cancelled() && m_CacheQueue.pop(img))
-                img->load_pixbuf(m_CacheCancel);
-        }
+    m_SignalCacheLoaded.connect(sigc::mem_fun(*this, &ImageList::on_cache_loaded));
+    m_SignalLoadProgressDisp.connect([&]() {
+        if (is_loading())
+            m_SignalLoadProgress(m_LoadCount);
     });
+    m_SignalLoadedDisp.connect(sigc::mem_fun(*this, &ImageList::on_directory_loaded));
+    m_SignalImagesValidated.connect(sigc::mem_fun(*this, &ImageList::on_images_validated));
+
+    // Leave some room for the thumbnail thread pool
+    const unsigned int n_threads{ std::clamp(std::thread::hardware_concurrency() / 2, 1u, 4u) };
+    for (unsigned int i = 0; i < n_threads; ++i)
+        m_CacheThreads.emplace_back(sigc::mem_fun(*this, &ImageList::cache_thread));
 }
 
 ImageList::~ImageList()
 {
     m_ThumbnailLoadedConn.disconnect();
+    cancel_thumbnail_flush();
+    m_Widget->m_Model->set_images(nullptr);
+    m_FitSizeConn.disconnect();
+    m_SignalLoadFinished.clear();
 
     reset();
 
-    m_CacheStop = true;
-    m_CacheCancel->cancel();
-    m_CacheCond.notify_one();
-    m_CacheThread.join();
+    {
+        std::scoped_lock lock{ m_CacheMutex };
+        m_CacheStop = true;
+    }
+    m_CacheCond.notify_all();
+
+    for (auto& t : m_CacheThreads)
+        t.join();
 }
 
 void ImageList::clear()
@@ -94,8 +104,15 @@ bool ImageList::load(const std::string path, std::string& error, int index)
         return false;
     }
 
-    std::vector<std::string> entries{ archive ? archive->get_entries(Archive::IMAGES)
-                                              : get_entries<Image>(dir_path) };
+    std::vector<std::string> entries;
+    if (archive)
+        entries = archive->get_entries(Archive::IMAGES);
+    else if (path == dir_path)
+        entries = get_entries<Image>(dir_path);
+    // Only the opened file is added for now, the rest of the directory is read by
+    // load_directory
+    else
+        entries.push_back(path);
 
     // No valid images in this directory
     if (entries.empty())
@@ -115,7 +132,7 @@ bool ImageList::load(const std::string path, std::string& error, int index)
     {
         m_Archive        = std::move(archive);
         m_ArchiveEntries = get_entries<Archive>(Glib::path_get_dirname(m_Archive->get_path()));
-        std::sort(m_ArchiveEntries.begin(), m_ArchiveEntries.end(), NaturalSort());
+        NaturalSort::sort(m_ArchiveEntries);
     }
     else
     {
@@ -125,7 +142,7 @@ bool ImageList::load(const std::string path, std::string& error, int index)
             sigc::mem_fun(*this, &ImageList::on_directory_changed));
     }
 
-    std::sort(entries.begin(), entries.end(), NaturalSort());
+    NaturalSort::sort(entries);
 
     if (path != dir_path && !m_Archive)
     {
@@ -146,10 +163,18 @@ bool ImageList::load(const std::string path, std::string& error, int index)
             img = std::make_shared<Image>(e);
         m_Images.push_back(std::move(img));
     }
+    update_path_index();
 
     m_SignalLoadSuccess();
     set_current(index, false, true);
-    m_ThumbnailThread = std::thread(sigc::mem_fun(*this, &ImageList::load_thumbnails));
+    start_thumbnail_thread();
+
+    if (path != dir_path && !m_Archive)
+    {
+        m_LoadCount  = 0;
+        m_LoadThread = std::thread(
+            [this, dir_path, image = m_Images.front()]() { load_directory(dir_path, image); });
+    }
 
     return true;
 }
@@ -204,59 +229,192 @@ void ImageList::on_cache_size_changed()
         update_cache();
 }
 
+void ImageList::on_fit_size_changed()
+{
+    m_FitSizeConn.disconnect();
+    m_FitSizeConn = Glib::signal_timeout().connect(
+        [&]() {
+            // Only the images in the cache window are scaled again
+            for (const auto& img : m_RecentCache)
+                img->reset_fit_pixbuf();
+
+            trim_cache();
+            queue_cache();
+
+            return false;
+        },
+        FitSizeDelay);
+}
+
 void ImageList::set_current(const size_t index, const bool from_widget, const bool force)
 {
     if (index == m_Index && !force)
         return;
 
-    m_Index = index;
+    {
+        std::scoped_lock lock{ m_ThumbnailMutex };
+        // Forced changes are caused by (re)loading, keep the last direction for the new list
+        if (!force)
+            update_navigation(index);
+
+        m_Index = index;
+    }
     m_SignalChanged(m_Images[m_Index]);
     update_cache();
 
-    if (m_ThreadPool.active())
-    {
-        cancel_thumbnail_thread();
-        m_ThumbnailThread = std::thread(sigc::mem_fun(*this, &ImageList::load_thumbnails));
-    }
+    reprioritize_thumbnails();
 
     if (!from_widget)
         m_Widget->set_selected(m_Index);
 }
 
-void ImageList::load_thumbnails()
+// The widget's thumbnails are only touched on the GUI thread, so the ones that still need
+// loading are collected here before the thread is started
+void ImageList::start_thumbnail_thread()
+{
+    std::vector<size_t> pending;
+    for (size_t i = 0; i < m_Images.size(); ++i)
+    {
+        if (!m_Widget->get_pixbuf(i))
+            pending.push_back(i);
+    }
+
+    m_ThumbnailThread =
+        std::thread([this, pending = std::move(pending)]() { load_thumbnails(pending); });
+}
+
+void ImageList::load_thumbnails(const std::vector<size_t>& pending)
 {
     m_ThumbnailCancel->reset();
+    queue_thumbnails(pending);
+}
 
-    std::vector<size_t> indices(m_Images.size());
-    std::iota(indices.begin(), indices.end(), 0);
-    std::sort(indices.begin(), indices.end(), m_IndexSort);
+// Adds the thumbnails to the pending queue and starts workers if the pool has room
+void ImageList::queue_thumbnails(const std::vector<size_t>& indices)
+{
+    size_t n_workers;
+    {
+        std::scoped_lock lock{ m_ThumbnailMutex };
+        for (const size_t i : indices)
+            if (!m_ThumbnailLoading.count(m_Images[i]))
+                m_ThumbnailPending.push(i, get_thumbnail_priority(i));
 
-    for (const size_t i : indices)
+        n_workers = m_ThreadPool.size() - std::min(m_ThumbnailWorkers, m_ThreadPool.size());
+        m_ThumbnailWorkers += n_workers;
+    }
+
+    for (size_t i = 0; i < n_workers; ++i)
+        m_ThreadPool.push([&]() { thumbnail_worker(); });
+}
+
+// Each worker loads whichever thumbnail is next when it is ready for one, so scrolling the
+// widget or navigating changes what is loaded next without restarting anything
+void ImageList::thumbnail_worker()
+{
+    size_t i;
+    std::shared_ptr<Image> image;
+    Glib::RefPtr<Gio::Cancellable> cancellable;
+
+    while (pop_thumbnail(i, image, cancellable))
+    {
+        Glib::RefPtr<Gdk::Pixbuf> thumb = image->get_thumbnail(cancellable);
+
+        {
+            std::scoped_lock lock{ m_ThumbnailMutex };
+            m_ThumbnailLoading.erase(image);
+        }
+
+        if (!cancellable->is_cancelled())
+        {
+            if (!thumb)
+                thumb = Image::get_missing_pixbuf();
+
+            m_ThumbnailQueue.push({ i, std::move(image), std::move(thumb) });
+            m_SignalThumbnailLoaded();
+        }
+    }
+}
+
+// Returns false once there is nothing left to load, the worker should then return
+bool ImageList::pop_thumbnail(size_t& index,
+                              std::shared_ptr<Image>& image,
+                              Glib::RefPtr<Gio::Cancellable>& cancellable)
+{
+    std::scoped_lock lock{ m_ThumbnailMutex };
+    if (m_ThumbnailCancel->is_cancelled() || m_ThumbnailPending.empty())
     {
-        if (m_ThumbnailCancel->is_cancelled())
-            break;
+        --m_ThumbnailWorkers;
+        return false;
+    }
+
+    m_ThumbnailPending.pop(index);
+    image       = m_Images[index];
+    cancellable = Gio::Cancellable::create();
+    m_ThumbnailLoading.emplace(image, cancellable);
+
+    return true;
+}
+
+// Called with m_ThumbnailMutex held after m_Images changed.  Pending thumbnails are moved
+// to the new index of their image, and ones being loaded for images that were removed are
+// cancelled and forgotten, the worker drops their result.  m_Index must already be updated
+void ImageList::update_thumbnail_indices(const ImageVector& old_images)
+{
+    std::vector<size_t> pending;
+    size_t i;
+
+    while (m_ThumbnailPending.pop(i))
+        pending.push_back(i);
 
-        // Only load thumbnails that haven't been already
-        auto it = m_Widget->m_ListStore->get_iter(std::to_string(i));
-        if (!it || !it->get_value(m_Widget->m_Columns.pixbuf))
-            m_ThreadPool.push([&, i]() {
-                Glib::RefPtr<Gdk::Pixbuf> thumb = m_Images[i]->get_thumbnail(m_ThumbnailCancel);
+    for (const size_t old_index : pending)
+        if (find_image(old_images[old_index], i))
+            m_ThumbnailPending.push(i, get_thumbnail_priority(i));
 
-                if (!m_ThumbnailCancel->is_cancelled())
-                {
-                    if (!thumb)
-                        thumb = Image::get_missing_pixbuf();
+    for (auto it = m_ThumbnailLoading.begin(); it != m_ThumbnailLoading.end();)
+    {
+        if (find_image(it->first, i))
+        {
+            ++it;
+            continue;
+        }
 
-                    m_ThumbnailQueue.emplace(i, std::move(thumb));
-                    m_SignalThumbnailLoaded();
-                }
-            });
+        it->second->cancel();
+        it = m_ThumbnailLoading.erase(it);
     }
 }
 
+void ImageList::reprioritize_thumbnails()
+{
+    std::scoped_lock lock{ m_ThumbnailMutex };
+    m_ThumbnailPending.reprioritize([&](const size_t i) { return get_thumbnail_priority(i); });
+}
+
+// Lower values are loaded first.  Thumbnails in view come first, then the next page of
+// them in the direction the widget was scrolled, then the rest by how close they are to
+// m_Index.  m_ThumbnailMutex must be held
+ImageList::ThumbnailPriority ImageList::get_thumbnail_priority(const size_t index) const
+{
+    if (m_HasVisibleRange)
+    {
+        const size_t first{ m_VisibleFirst }, last{ m_VisibleLast }, page{ last - first + 1 };
+
+        if (index >= first && index <= last)
+            return { 0, index - first };
+
+        const size_t d{ index < first ? first - index : index - last };
+        if (d <= page && (index > last) == (m_ScrollDirection > 0))
+            return { 1, d };
+    }
+
+    // Same order as get_cache_window
+    const bool behind{ m_Direction < 0 ? index > m_Index : index < m_Index };
+    return { 2, get_prefetch_distance(index) * 2 + behind };
+}
+
 // Resets the image list to it's initial state
 void ImageList::reset()
 {
+    cancel_load();
     cancel_cache();
 
     if (m_FileMonitor)
@@ -264,10 +422,18 @@ void ImageList::reset()
         m_FileMonitor->cancel();
         m_FileMonitor.reset();
     }
+    cancel_directory_events();
 
     cancel_thumbnail_thread();
 
+    for (const auto& img : m_RecentCache)
+        free_cache_image(img);
+    m_RecentCache.clear();
+    m_CacheLoadedQueue.clear();
+    update_cache_memory_size();
+
     m_Images.clear();
+    m_PathIndex.clear();
     m_Widget->clear();
 
     m_Archive = nullptr;
@@ -275,14 +441,172 @@ void ImageList::reset()
     m_Index = 0;
 }
 
-void ImageList::cancel_thumbnail_thread()
+// Runs on m_LoadThread.  Reads every image in dir_path and sorts them, image is the one
+// that was opened and is used in place of creating a new Image for the same path
+void ImageList::load_directory(const std::string dir_path, const std::shared_ptr<Image> image)
+{
+    ImageVector images;
+    size_t index{ 0 };
+
+    try
+    {
+        std::vector<std::string> entries;
+        for (const std::string& e : Glib::Dir(dir_path))
+        {
+            if (m_LoadCancel)
+                return;
+
+            std::string path{ Glib::build_filename(dir_path, e) };
+            if (!Image::is_valid_extension(path))
+                continue;
+
+            entries.push_back(std::move(path));
+            if (entries.size() % LoadProgressInterval == 0)
+            {
+                m_LoadCount = entries.size();
+                m_SignalLoadProgressDisp();
+            }
+        }
+
+        // The opened image was valid but may not have a known extension
+        if (std::find(entries.begin(), entries.end(), image->get_path()) == entries.end())
+            entries.push_back(image->get_path());
+
+        if (!NaturalSort::sort(entries, &m_LoadCancel))
+            return;
+
+        images.reserve(entries.size());
+        for (std::string& e : entries)
+        {
+            if (m_LoadCancel)
+                return;
+
+            if (e == image->get_path())
+            {
+                index = images.size();
+                images.push_back(image);
+            }
+            else
+            {
+                images.push_back(std::make_shared<Image>(std::move(e)));
+            }
+        }
+    }
+    catch (const Glib::FileError& ex)
+    {
+        std::cerr << "ImageList::load_directory: " << ex.what() << std::endl;
+    }
+
+    {
+        std::scoped_lock lock{ m_LoadMutex };
+        m_LoadedImages = std::move(images);
+        m_LoadedIndex  = index;
+        m_Loaded       = true;
+    }
+
+    m_SignalLoadedDisp();
+}
+
+void ImageList::cancel_load()
+{
+    if (!m_LoadThread.joinable())
+        return;
+
+    m_LoadCancel = true;
+    m_LoadThread.join();
+    m_LoadCancel = false;
+
+    {
+        std::scoped_lock lock{ m_LoadMutex };
+        m_LoadedImages.clear();
+        m_Loaded = false;
+    }
+
+    m_SignalLoadFinished();
+}
+
+// Replaces the single opened image with the whole directory, the opened image stays
+// current and keeps whatever it has loaded
+void ImageList::on_directory_loaded()
+{
+    ImageVector images;
+    size_t index;
+
+    {
+        std::scoped_lock lock{ m_LoadMutex };
+        if (!m_Loaded)
+            return;
+
+        images   = std::move(m_LoadedImages);
+        index    = m_LoadedIndex;
+        m_Loaded = false;
+    }
+
+    m_LoadThread.join();
+    m_SignalLoadFinished();
+
+    // Replay the file monitor events that came in while the directory was being read,
+    // ones it already picked up are skipped by on_directory_events
+    if (!m_DirectoryEvents.empty() && !m_DirectoryEventConn)
+        m_DirectoryEventConn = Glib::signal_timeout().connect(
+            sigc::mem_fun(*this, &ImageList::on_directory_events), DirectoryEventDelay);
+
+    if (images.size() <= 1)
+        return;
+
+    if (m_ThumbnailThread.joinable())
+        m_ThumbnailThread.join();
+
+    // The opened image's thumbnail keeps loading if it hasn't finished
+    {
+        std::scoped_lock lock{ m_ThumbnailMutex };
+        const auto old_images{ std::exchange(m_Images, std::move(images)) };
+        update_path_index();
+        m_Index = index;
+        update_thumbnail_indices(old_images);
+    }
+
+    // The opened image keeps its thumbnail, the model reads it from the image
+    m_Widget->clear();
+    m_Widget->reserve(m_Images.size());
+
+    // The opened image is the only one that could have been cached
+    if (!m_Cache.empty())
+        m_Cache = { index };
+
+    update_cache();
+    m_Widget->set_selected(m_Index);
+    start_thumbnail_thread();
+
+    m_SignalSizeChanged();
+}
+
+void ImageList::cancel_thumbnail_jobs()
 {
     m_ThumbnailCancel->cancel();
 
+    std::scoped_lock lock{ m_ThumbnailMutex };
+    for (const auto& [image, cancellable] : m_ThumbnailLoading)
+        cancellable->cancel();
+}
+
+void ImageList::cancel_thumbnail_thread()
+{
+    cancel_thumbnail_jobs();
+    cancel_thumbnail_flush();
+
     m_ThreadPool.kill();
     if (m_ThumbnailThread.joinable())
         m_ThumbnailThread.join();
 
+    {
+        std::scoped_lock lock{ m_ThumbnailMutex };
+        m_ThumbnailPending.clear();
+        m_ThumbnailLoading.clear();
+        // Killing the pool drops tasks that never started
+        m_ThumbnailWorkers = 0;
+    }
+
     m_ThumbnailQueue.clear();
 }
 
@@ -310,20 +634,104 @@ std::vector<std::string> ImageList::get_entries(const std::string& path) const
     return entries;
 }
 
+// Thumbnails are added to the widget once per frame instead of as each one loads
 void ImageList::on_thumbnail_loaded()
 {
-    m_ThumbnailLoadedConn.block();
-    PixbufPair p;
+    if (m_ThumbnailFlushQueued)
+        return;
+
+    m_ThumbnailFlushQueued = true;
+
+    // The frame clock only ticks for realized widgets
+    auto* widget{ dynamic_cast<Gtk::Widget*>(m_Widget) };
+    if (widget && widget->get_realized())
+        m_ThumbnailTickId =
+            widget->add_tick_callback(sigc::mem_fun(*this, &ImageList::on_thumbnail_tick));
+    else
+        m_ThumbnailIdleConn = Glib::signal_idle().connect(
+            sigc::bind_return(sigc::mem_fun(*this, &ImageList::flush_thumbnails), false));
+}
+
+bool ImageList::on_thumbnail_tick(const Glib::RefPtr<Gdk::FrameClock>&)
+{
+    // Returning false removes the callback
+    m_ThumbnailTickId = 0;
+    flush_thumbnails();
+    return false;
+}
+
+void ImageList::cancel_thumbnail_flush()
+{
+    if (m_ThumbnailTickId != 0)
+    {
+        dynamic_cast<Gtk::Widget*>(m_Widget)->remove_tick_callback(m_ThumbnailTickId);
+        m_ThumbnailTickId = 0;
+    }
 
-    while (m_ThumbnailCancel && !m_ThumbnailCancel->is_cancelled() && m_ThumbnailQueue.pop(p))
-        m_Widget->set_pixbuf(p.first, p.second);
+    m_ThumbnailIdleConn.disconnect();
+    m_ThumbnailFlushQueued = false;
+}
 
-    m_ThumbnailLoadedConn.unblock();
+void ImageList::flush_thumbnails()
+{
+    m_ThumbnailFlushQueued = false;
+
+    Widget::PixbufVector pixbufs;
+    ThumbnailItem item;
+
+    while (m_ThumbnailCancel && !m_ThumbnailCancel->is_cancelled() && m_ThumbnailQueue.pop(item))
+    {
+        // The image may have moved while its thumbnail was loading
+        size_t i{ item.index };
+        if ((i < m_Images.size() && m_Images[i] == item.image) || find_image(item.image, i))
+            pixbufs.emplace_back(i, std::move(item.pixbuf));
+    }
+
+    if (!pixbufs.empty())
+        m_Widget->set_pixbufs(pixbufs);
 
     if (!m_ThreadPool.active())
         m_SignalThumbnailsLoaded();
 }
 
+void ImageList::on_visible_range_changed()
+{
+    size_t first{ 0 }, last{ 0 };
+    const bool visible{ m_Widget->get_visible_range(first, last) && first <= last };
+
+    std::scoped_lock lock{ m_ThumbnailMutex };
+    if (visible == m_HasVisibleRange && first == m_VisibleFirst && last == m_VisibleLast)
+        return;
+
+    if (visible && m_HasVisibleRange && first != m_VisibleFirst)
+        m_ScrollDirection = first > m_VisibleFirst ? 1 : -1;
+
+    // Only thumbnails within a page of the old or new range can have a different priority
+    auto get_window{ [&]() {
+        const size_t page{ m_VisibleLast - m_VisibleFirst + 1 };
+        return std::make_pair(m_VisibleFirst - std::min(m_VisibleFirst, page),
+                              std::min(m_VisibleLast + page + 1, m_Images.size()));
+    } };
+
+    std::pair<size_t, size_t> old_window{ 0, 0 }, new_window{ 0, 0 };
+    if (m_HasVisibleRange)
+        old_window = get_window();
+
+    m_HasVisibleRange = visible;
+    m_VisibleFirst    = first;
+    m_VisibleLast     = last;
+
+    if (m_HasVisibleRange)
+        new_window = get_window();
+
+    for (const auto& [from, to] : { old_window, new_window })
+        for (size_t i = from; i < to; ++i)
+            if (m_ThumbnailPending.contains(i))
+                m_ThumbnailPending.push(i, get_thumbnail_priority(i));
+}
+
+// Events are collected and handled together by on_directory_events, so copying many files
+// in to the directory doesn't add them one at a time
 void ImageList::on_directory_changed(const Glib::RefPtr<Gio::File>& file,
                                      const Glib::RefPtr<Gio::File>&,
                                      Gio::FileMonitorEvent event)
@@ -331,75 +739,270 @@ void ImageList::on_directory_changed(const Glib::RefPtr<Gio::File>& file,
     if (!file)
         return;
 
-    ImageVector::iterator it;
-    auto comp = [&file](const std::shared_ptr<Image>& i) {
-        return i->get_path() == file->get_path();
-    };
+    std::string path{ file->get_path() };
 
     if (event == Gio::FILE_MONITOR_EVENT_DELETED)
     {
-        if ((it = std::find_if(m_Images.begin(), m_Images.end(), comp)) != m_Images.end())
-        {
-            size_t index = it - m_Images.begin();
-            bool current = index == m_Index;
-
-            // Adjust m_Index if the deleted file was before it
-            if (index < m_Index)
-                --m_Index;
-
-            m_Widget->erase(index);
-            m_Images.erase(it);
-
-            if (current)
-            {
-                if (m_Images.empty())
-                {
-                    clear();
-                    return;
-                }
-                else
-                {
-                    set_current(index == 0 ? 0 : index - 1, false, true);
-                }
-            }
-            else
-            {
-                update_cache();
-            }
-
-            m_SignalSizeChanged();
-        }
-        else if (file->get_path() == Glib::path_get_dirname(get_current()->get_path()))
+        if (path == Glib::path_get_dirname(get_current()->get_path()))
         {
             clear();
+            return;
         }
+
+        m_DirectoryEvents[std::move(path)] = false;
     }
     // The changed event is used in case the created event was too quick,
     // and the file was invalid while still being written
-    else if ((event == Gio::FILE_MONITOR_EVENT_CREATED ||
-              event == Gio::FILE_MONITOR_EVENT_CHANGES_DONE_HINT) &&
-             Image::is_valid(file->get_path()))
+    else if (event == Gio::FILE_MONITOR_EVENT_CREATED ||
+             event == Gio::FILE_MONITOR_EVENT_CHANGES_DONE_HINT)
+    {
+        m_DirectoryEvents[std::move(path)] = true;
+    }
+    else
     {
-        // Make sure the image wasn't already added
-        if (event == Gio::FILE_MONITOR_EVENT_CHANGES_DONE_HINT &&
-            std::find_if(m_Images.begin(), m_Images.end(), comp) != m_Images.end())
+        return;
+    }
+
+    // Indices change once the directory has been read, events are held until then
+    // and replayed by on_directory_loaded
+    if (!m_DirectoryEventConn && !is_loading())
+        m_DirectoryEventConn = Glib::signal_timeout().connect(
+            sigc::mem_fun(*this, &ImageList::on_directory_events), DirectoryEventDelay);
+}
+
+// Deleted images are removed right away, created files are validated by m_DirectoryThread.
+// Events are held until the last created files have been added so they are handled in order
+bool ImageList::on_directory_events()
+{
+    if (m_DirectoryThread.joinable())
+        return true;
+
+    std::vector<std::string> created, deleted;
+    for (auto& [path, c] : m_DirectoryEvents)
+    {
+        const bool exists{ m_PathIndex.count(path) != 0 };
+        if (c && !exists)
+            created.push_back(path);
+        else if (!c && exists)
+            deleted.push_back(path);
+    }
+    m_DirectoryEvents.clear();
+
+    erase_images(deleted);
+
+    // Erasing the last image clears the list
+    if (!created.empty() && !m_Images.empty())
+        m_DirectoryThread = std::thread(
+            [this, paths = std::move(created)]() mutable { validate_images(std::move(paths)); });
+
+    return false;
+}
+
+// Runs on m_DirectoryThread
+void ImageList::validate_images(std::vector<std::string> paths)
+{
+    if (!NaturalSort::sort(paths, &m_DirectoryCancel))
+        return;
+
+    ImageVector images;
+    for (std::string& path : paths)
+    {
+        if (m_DirectoryCancel)
             return;
 
-        std::shared_ptr<Image> img = std::make_shared<Image>(file->get_path());
-        it           = std::lower_bound(m_Images.begin(), m_Images.end(), img, NaturalSort());
-        size_t index = it - m_Images.begin();
+        if (Image::is_valid(path))
+            images.push_back(std::make_shared<Image>(std::move(path)));
+    }
+
+    m_DirectoryImages = std::move(images);
+    m_SignalImagesValidated();
+}
+
+void ImageList::cancel_directory_events()
+{
+    m_DirectoryEventConn.disconnect();
+    m_DirectoryEvents.clear();
+
+    if (m_DirectoryThread.joinable())
+    {
+        m_DirectoryCancel = true;
+        m_DirectoryThread.join();
+        m_DirectoryCancel = false;
+    }
+
+    m_DirectoryImages.clear();
+}
+
+void ImageList::on_images_validated()
+{
+    // Already cancelled
+    if (!m_DirectoryThread.joinable())
+        return;
+
+    m_DirectoryThread.join();
+    insert_images(std::exchange(m_DirectoryImages, {}));
+}
+
+// images must be sorted, each one is merged in to m_Images in a single pass
+void ImageList::insert_images(const ImageVector& images)
+{
+    if (images.empty() || m_Images.empty())
+        return;
+
+    const auto current{ get_current() };
+    ImageVector cached, merged;
+    for (const size_t i : m_Cache)
+        cached.push_back(m_Images[i]);
+
+    std::vector<size_t> inserted;
+    merged.reserve(m_Images.size() + images.size());
+
+    // Each path is tokenized once, and compared the same way NaturalSort::sort ordered them
+    std::vector<NaturalSort::Item> items;
+    items.reserve(m_Images.size());
+    for (const auto& img : m_Images)
+        items.push_back(NaturalSort::make_item(img->get_path()));
+
+    size_t pos{ 0 };
+    for (const auto& img : images)
+    {
+        if (m_PathIndex.count(img->get_path()))
+            continue;
+
+        const NaturalSort::Item item{ NaturalSort::make_item(img->get_path()) };
+        while (pos < m_Images.size() && items[pos] < item)
+            merged.push_back(m_Images[pos++]);
+
+        inserted.push_back(merged.size());
+        merged.push_back(img);
+    }
+
+    if (inserted.empty())
+        return;
+
+    merged.insert(merged.end(), m_Images.begin() + pos, m_Images.end());
+
+    // load_thumbnails queues indices of the current rows, it must finish before they change
+    if (m_ThumbnailThread.joinable())
+        m_ThumbnailThread.join();
+
+    // The model reads m_Images, so it is swapped before any rows are inserted
+    {
+        std::scoped_lock lock{ m_ThumbnailMutex };
+        const auto old_images{ std::exchange(m_Images, std::move(merged)) };
+        update_path_index();
+        get_index_of(current->get_path(), m_Index);
+        update_thumbnail_indices(old_images);
+    }
+    restore_cache(cached);
+
+    // Rows are inserted in ascending order so each index is already its final one
+    for (const size_t i : inserted)
+        m_Widget->insert(i);
+
+    update_cache();
+    queue_thumbnails(inserted);
+    m_SignalSizeChanged();
+}
+
+void ImageList::erase_images(const std::vector<std::string>& paths)
+{
+    std::vector<size_t> indices;
+    for (const std::string& path : paths)
+    {
+        size_t i;
+        if (get_index_of(path, i))
+            indices.push_back(i);
+    }
+
+    if (indices.empty())
+        return;
+
+    std::sort(indices.begin(), indices.end());
+
+    const auto current{ get_current() };
+    const bool current_erased{ std::binary_search(indices.begin(), indices.end(), m_Index) };
+    // The number of images before the current one that are left
+    const size_t before{ m_Index - (std::lower_bound(indices.begin(), indices.end(), m_Index) -
+                                    indices.begin()) };
+
+    ImageVector cached;
+    for (const size_t i : m_Cache)
+        cached.push_back(m_Images[i]);
 
-        if (index <= m_Index)
-            ++m_Index;
+    if (indices.size() == m_Images.size())
+    {
+        clear();
+        return;
+    }
 
-        m_Widget->insert(index, img->get_thumbnail(m_ThumbnailCancel));
-        m_Images.insert(it, img);
+    // load_thumbnails queues indices of the current rows, it must finish before they change
+    if (m_ThumbnailThread.joinable())
+        m_ThumbnailThread.join();
+
+    ImageVector images{ m_Images };
+    for (const size_t i : indices)
+    {
+        cancel_cache_image(images[i]);
+        m_RecentCache.remove(images[i]);
+        images[i] = nullptr;
+    }
+    images.erase(std::remove(images.begin(), images.end(), nullptr), images.end());
 
+    // Thumbnails of the erased images stop loading, the rest keep going.  The model reads
+    // m_Images, so it is swapped before any rows are erased
+    {
+        std::scoped_lock lock{ m_ThumbnailMutex };
+        const auto old_images{ std::exchange(m_Images, std::move(images)) };
+        update_path_index();
+        if (current_erased)
+            m_Index = before == 0 ? 0 : before - 1;
+        else
+            get_index_of(current->get_path(), m_Index);
+        update_thumbnail_indices(old_images);
+    }
+    restore_cache(cached);
+
+    // From the end so the remaining indices still match the widget's rows
+    for (auto i = indices.rbegin(); i != indices.rend(); ++i)
+        m_Widget->erase(*i);
+
+    if (current_erased)
+        set_current(m_Index, false, true);
+    else
         update_cache();
-        m_SignalSizeChanged();
+
+    m_SignalSizeChanged();
+}
+
+void ImageList::update_path_index()
+{
+    m_PathIndex.clear();
+    m_PathIndex.reserve(m_Images.size());
+
+    for (size_t i = 0; i < m_Images.size(); ++i)
+        m_PathIndex.emplace(m_Images[i]->get_path(), i);
+}
+
+// Sets m_Cache to the new indices of cached after m_Images has changed, images that were
+// removed are left out
+void ImageList::restore_cache(const ImageVector& cached)
+{
+    m_Cache.clear();
+
+    for (const auto& img : cached)
+    {
+        size_t i;
+        if (find_image(img, i))
+            m_Cache.push_back(i);
     }
 }
 
+bool ImageList::find_image(const std::shared_ptr<Image>& image, size_t& index) const
+{
+    return get_index_of(image->get_path(), index) && m_Images[index] == image;
+}
+
 void ImageList::set_current_relative(const int d)
 {
     if ((d > 0 && m_Index + 1 < m_Images.size()) || (d < 0 && m_Index > 0))
@@ -421,13 +1024,141 @@ void ImageList::set_current_relative(const int d)
     }
 }
 
-void ImageList::update_cache()
+// Tracks the direction and speed of navigation for the prefetch order, m_ThumbnailMutex
+// must be held since the thumbnail thread reads them
+void ImageList::update_navigation(const size_t index)
 {
-    std::vector<size_t> cache(m_Images.size()), diff;
-    std::iota(cache.begin(), cache.end(), 0);
-    std::sort(cache.begin(), cache.end(), m_IndexSort);
+    using namespace std::chrono;
+    const auto now{ steady_clock::now() };
+    const int direction{ index > m_Index ? 1 : -1 };
+    const bool step{ (index > m_Index ? index - m_Index : m_Index - index) == 1 };
+
+    // Consecutive single steps in the same direction with little time between them
+    if (step && direction == m_Direction && now - m_LastNavigation < FastNavigationInterval)
+        ++m_Streak;
+    else
+        m_Streak = step ? 1 : 0;
 
-    cache.resize(Settings.get_int("CacheSize") * 2 + 1);
+    m_Direction      = direction;
+    m_LastNavigation = now;
+}
+
+bool ImageList::is_reading_fast() const
+{
+    return m_Streak >= FastNavigationStreak;
+}
+
+// Returns how far away index is from m_Index for prefetching purposes.
+// Images behind the direction of navigation count as further away, more so when
+// reading quickly
+size_t ImageList::get_prefetch_distance(const size_t index) const
+{
+    const size_t d{ index > m_Index ? index - m_Index : m_Index - index };
+
+    if (m_Direction != 0 && index != m_Index && (index > m_Index) != (m_Direction > 0))
+        return d * (is_reading_fast() ? 3 : 2);
+
+    return d;
+}
+
+// The number of images in the cache window.  It is widened while reading quickly,
+// the extra images are furthest from m_Index so the memory limit will drop them first
+size_t ImageList::get_cache_window_size() const
+{
+    const size_t n{ static_cast<size_t>(std::max(Settings.get_int("CacheSize"), 0)) };
+    return n * (is_reading_fast() ? 3 : 2) + 1;
+}
+
+// Each cache thread loads images from the queue, nearest images are queued first so the
+// current image will always be the first to start loading.  Images being loaded by
+// one thread are skipped by the others
+void ImageList::cache_thread()
+{
+    while (!m_CacheStop)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_CacheMutex);
+            m_CacheCond.wait(lock, [&]() { return !m_CacheQueue.empty() || m_CacheStop; });
+        }
+
+        CacheItem item;
+        while (!m_CacheStop && m_CacheQueue.pop(item))
+        {
+            if (item.cancellable->is_cancelled())
+                continue;
+
+            // Images are queued nearest first, so once the limit has been reached
+            // the remaining images would not fit either
+            if (!item.required && m_CacheMemorySize >= get_cache_memory_limit())
+                continue;
+
+            size_t size;
+            {
+                std::scoped_lock lock{ m_CacheMutex };
+                size = item.image->get_memory_size();
+                if (!m_CacheLoading.emplace(item.image, size).second)
+                    continue;
+            }
+
+            item.image->load_pixbuf(item.cancellable);
+            // The current image is scaled by the ImageBox as soon as it has loaded
+            if (!item.required)
+                item.image->create_fit_pixbuf(item.cancellable);
+
+            {
+                std::scoped_lock lock{ m_CacheMutex };
+                // The image may have been freed meanwhile, so this can shrink too
+                const size_t new_size{ item.image->get_memory_size() };
+                if (new_size >= size)
+                    m_CacheMemorySize += new_size - size;
+                else
+                    m_CacheMemorySize -= std::min(size - new_size, m_CacheMemorySize.load());
+                m_CacheLoading.erase(item.image);
+            }
+
+            m_CacheLoadedQueue.push(std::move(item));
+            m_SignalCacheLoaded();
+        }
+    }
+}
+
+// Returns the indices of the cache window sorted by how close they are to m_Index, images
+// ahead in the direction of navigation come first.  The window is built outwards from
+// m_Index so this doesn't depend on the number of images
+std::vector<size_t> ImageList::get_cache_window() const
+{
+    const size_t n{ std::min(get_cache_window_size(), m_Images.size()) };
+    std::vector<size_t> window;
+    window.reserve(n);
+
+    if (n == 0)
+        return window;
+
+    window.push_back(m_Index);
+
+    // Distance to the next image after and before m_Index
+    size_t next{ 1 }, prev{ 1 };
+    while (window.size() < n)
+    {
+        bool take_next{ m_Index + next < m_Images.size() };
+
+        if (take_next && prev <= m_Index)
+        {
+            const size_t dnext{ get_prefetch_distance(m_Index + next) },
+                dprev{ get_prefetch_distance(m_Index - prev) };
+            // Ties go to the image ahead, or after m_Index when there is no direction yet
+            take_next = dnext == dprev ? m_Direction >= 0 : dnext < dprev;
+        }
+
+        window.push_back(take_next ? m_Index + next++ : m_Index - prev++);
+    }
+
+    return window;
+}
+
+void ImageList::update_cache()
+{
+    std::vector<size_t> cache{ get_cache_window() }, diff;
 
     // Get the indices of the images no longer in the cache
     if (!m_Cache.empty())
@@ -440,25 +1171,174 @@ void ImageList::update_cache()
             m_Cache.begin(), m_Cache.end(), tmp.begin(), tmp.end(), std::back_inserter(diff));
     }
 
-    cancel_cache();
+    // Images that stay in the cache keep loading, only the ones that left it are cancelled
     m_Cache = cache;
 
-    // Free images that are no longer in the cache
+    // Images that are back in the cache window are accounted for by m_Cache
+    m_RecentCache.remove_if([&](const std::shared_ptr<Image>& img) {
+        return std::any_of(
+            m_Cache.begin(), m_Cache.end(), [&](const size_t i) { return m_Images[i] == img; });
+    });
+
+    // Images that are no longer in the cache are kept around as recently used
+    // until they no longer fit within the memory limit, stop loading them if they haven't
+    // finished yet
     for (const auto i : diff)
+    {
         if (i <= m_Images.size() - 1)
-            m_Images[i]->reset_pixbuf();
+        {
+            cancel_cache_image(m_Images[i]);
+            m_RecentCache.push_front(m_Images[i]);
+        }
+    }
 
-    // Copy the imgaes into the queue and
-    // tell the cache thread it has some work
-    for (const auto i : m_Cache)
+    trim_cache();
+    queue_cache();
+}
+
+// Copy the images into the queue and tell the cache threads they have some work
+void ImageList::queue_cache()
+{
     {
-        m_CacheQueue.push(m_Images[i]);
-        m_CacheCond.notify_one();
+        std::scoped_lock lock{ m_CacheMutex };
+        m_CacheQueue.clear();
+
+        for (const auto i : m_Cache)
+        {
+            const auto& img{ m_Images[i] };
+            auto it{ m_CacheCancellables.find(img) };
+
+            if (it == m_CacheCancellables.end())
+                it = m_CacheCancellables.emplace(img, Gio::Cancellable::create()).first;
+
+            m_CacheQueue.push({ img, it->second, i == m_Index });
+        }
     }
+
+    m_CacheCond.notify_all();
 }
 
 void ImageList::cancel_cache()
 {
+    for (const auto& [img, c] : m_CacheCancellables)
+        c->cancel();
+
+    m_CacheCancellables.clear();
     m_Cache.clear();
     m_CacheQueue.clear();
 }
+
+// Cancels the image if it is being loaded, or waiting to be loaded by the cache threads
+void ImageList::cancel_cache_image(const std::shared_ptr<Image>& img)
+{
+    auto it{ m_CacheCancellables.find(img) };
+
+    if (it != m_CacheCancellables.end())
+    {
+        it->second->cancel();
+        m_CacheCancellables.erase(it);
+    }
+}
+
+void ImageList::free_cache_image(const std::shared_ptr<Image>& img)
+{
+    cancel_cache_image(img);
+
+    // Images that are still being loaded will be freed by on_cache_loaded
+    std::scoped_lock lock{ m_CacheMutex };
+    if (m_CacheLoading.find(img) == m_CacheLoading.end())
+        img->reset_pixbuf();
+}
+
+// Frees decoded images until the cache fits within the CacheMemory limit.
+// Recently used images outside of the cache window are freed first, least recently used first,
+// then the images in the window that are furthest from the current image
+void ImageList::trim_cache()
+{
+    const size_t limit{ get_cache_memory_limit() };
+    update_cache_memory_size();
+
+    while (!m_RecentCache.empty() && m_CacheMemorySize + m_RecentCacheMemorySize > limit)
+    {
+        free_cache_image(m_RecentCache.back());
+        m_RecentCache.pop_back();
+        update_cache_memory_size();
+    }
+
+    if (m_CacheMemorySize <= limit)
+        return;
+
+    // m_Cache is sorted by distance from m_Index, find the first image that doesn't fit
+    size_t size{ 0 };
+    auto it{ std::find_if(m_Cache.begin(), m_Cache.end(), [&](const size_t i) {
+        size += m_Images[i]->get_memory_size();
+        return i != m_Index && size > limit;
+    }) };
+
+    for (auto i = it; i != m_Cache.end(); ++i)
+        free_cache_image(m_Images[*i]);
+    m_Cache.erase(it, m_Cache.end());
+
+    update_cache_memory_size();
+}
+
+// Images that are being loaded are counted with the size they had when their cache thread
+// started, the thread adds the difference once it has finished
+void ImageList::update_cache_memory_size()
+{
+    std::scoped_lock lock{ m_CacheMutex };
+    size_t cache_size{ 0 }, recent_size{ 0 };
+
+    auto get_size{ [&](const std::shared_ptr<Image>& img) {
+        auto it{ m_CacheLoading.find(img) };
+        return it != m_CacheLoading.end() ? it->second : img->get_memory_size();
+    } };
+
+    for (const auto i : m_Cache)
+        if (i < m_Images.size())
+            cache_size += get_size(m_Images[i]);
+
+    for (const auto& img : m_RecentCache)
+        recent_size += get_size(img);
+
+    TotalCacheMemorySize -= m_AccountedMemorySize;
+    TotalCacheMemorySize += cache_size + recent_size;
+
+    m_CacheMemorySize       = cache_size;
+    m_RecentCacheMemorySize = recent_size;
+    m_AccountedMemorySize   = cache_size + recent_size;
+}
+
+void ImageList::on_cache_loaded()
+{
+    CacheItem item;
+    bool requeue{ false };
+
+    while (m_CacheLoadedQueue.pop(item))
+    {
+        const auto& img{ item.image };
+        auto it{ m_CacheCancellables.find(img) };
+
+        // The image was cancelled and then queued again while it was being loaded,
+        // the other cache threads skipped it so it needs to be queued again
+        if (it != m_CacheCancellables.end() && it->second != item.cancellable)
+            requeue = true;
+        else if (it != m_CacheCancellables.end())
+            m_CacheCancellables.erase(it);
+
+        bool cached{ std::any_of(m_Cache.begin(),
+                                 m_Cache.end(),
+                                 [&](const size_t i) { return m_Images[i] == img; }) ||
+                     std::find(m_RecentCache.begin(), m_RecentCache.end(), img) !=
+                         m_RecentCache.end() };
+
+        // This image left the cache while it was being loaded
+        if (!cached)
+            img->reset_pixbuf();
+    }
+
+    trim_cache();
+
+    if (requeue)
+        queue_cache();
+}
@@ -2,13 +2,19 @@
 
 #include "archive/archive.h"
 #include "image.h"
+#include "priorityqueue.h"
 #include "threadpool.h"
+#include "thumbnailmodel.h"
 #include "tsqueue.h"
 #include "util.h"
 
+#include <chrono>
 #include <gtkmm.h>
+#include <list>
+#include <map>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace AhoViewer
@@ -24,8 +30,33 @@ namespace AhoViewer
         // Emitted when AutoOpenArchive is true and loading an archive fails.
         using SignalArchiveErrorType = sigc::signal<void, const std::string>;
 
+        // Emitted while the rest of a directory is being read with the number of images
+        // found so far
+        using SignalLoadProgressType = sigc::signal<void, const size_t>;
+
         // Used for async thumbnail pixbuf loading
         using PixbufPair = std::pair<size_t, Glib::RefPtr<Gdk::Pixbuf>>;
+        // Thumbnails are loaded in order of (0 in view, 1 ahead of the view, 2 the rest),
+        // then by the second value
+        using ThumbnailPriority = std::pair<int, size_t>;
+
+        // An image waiting to be loaded by the cache threads
+        struct CacheItem
+        {
+            std::shared_ptr<Image> image;
+            Glib::RefPtr<Gio::Cancellable> cancellable;
+            // Load the image even if the cache memory limit has been reached
+            bool required;
+        };
+
+        // A thumbnail loaded by a thumbnail worker, index is where image was when it was
+        // popped from the pending queue
+        struct ThumbnailItem
+        {
+            size_t index;
+            std::shared_ptr<Image> image;
+            Glib::RefPtr<Gdk::Pixbuf> pixbuf;
+        };
 
     public:
         // ImageList::Widget {{{
@@ -36,7 +67,9 @@ namespace AhoViewer
             using SignalSelectedChangedType = sigc::signal<void, const size_t>;
 
         public:
-            Widget() : m_ListStore(Gtk::ListStore::create(m_Columns)) { }
+            using PixbufVector = std::vector<PixbufPair>;
+
+            Widget() : m_Model(ThumbnailModel::create()) { }
             virtual ~Widget() = default;
 
             SignalSelectedChangedType signal_selected_changed() const
@@ -52,43 +85,76 @@ namespace AhoViewer
             virtual void set_selected(const size_t) = 0;
             virtual void scroll_to_selected()       = 0;
 
+            // Sets first and last to the range of thumbnails currently in view, returns
+            // false if none are
+            virtual bool get_visible_range(size_t&, size_t&) const { return false; }
+            // Emitted when the range of thumbnails in view may have changed
+            sigc::signal<void> signal_visible_range_changed() const
+            {
+                return m_SignalVisibleRangeChanged;
+            }
+
             virtual void clear()
             {
                 m_CursorConn.block();
-                m_ListStore->clear();
+                detach_model();
+                m_Model->clear();
+                attach_model();
                 m_CursorConn.unblock();
             }
-            virtual void set_pixbuf(const size_t index, const Glib::RefPtr<Gdk::Pixbuf>& pixbuf)
+            void set_pixbuf(const size_t index, const Glib::RefPtr<Gdk::Pixbuf>& pixbuf)
             {
-                Gtk::TreeIter it = m_ListStore->get_iter(std::to_string(index));
-                if (it)
-                    it->set_value(0, pixbuf);
+                m_Model->set_pixbuf(index, pixbuf);
             }
-            void reserve(const size_t s)
+            // Called once per frame with the thumbnails that finished loading since the
+            // last one
+            virtual void set_pixbufs(const PixbufVector& pixbufs)
             {
-                for (size_t i = 0; i < s; ++i)
-                    m_ListStore->append();
+                for (const auto& [index, pixbuf] : pixbufs)
+                    set_pixbuf(index, pixbuf);
             }
-            void erase(const size_t i)
+            Glib::RefPtr<Gdk::Pixbuf> get_pixbuf(const size_t index) const
+            {
+                return m_Model->get_pixbuf(index);
+            }
+            void reserve(const size_t s)
             {
-                Gtk::TreeIter it = m_ListStore->get_iter(std::to_string(i));
-                if (it)
-                    m_ListStore->erase(it);
+                // When the model is empty the view is detached while the rows are added so
+                // it builds them once when it's attached again, instead of handling a
+                // signal per row.  Appending to a non empty model keeps the view attached
+                // so its scroll position and selection are kept
+                if (m_Model->size() > 0)
+                {
+                    m_Model->append(s);
+                    return;
+                }
+
+                m_CursorConn.block();
+                detach_model();
+                m_Model->append(s);
+                attach_model();
+                m_CursorConn.unblock();
             }
-            void insert(const size_t i, const Glib::RefPtr<Gdk::Pixbuf>& pixbuf)
+            // The image list selects another image itself if the selected one is erased
+            void erase(const size_t i)
             {
-                Gtk::TreeIter it = m_ListStore->get_iter(std::to_string(i));
-                it               = it ? m_ListStore->insert(it) : m_ListStore->append();
-                it->set_value(0, pixbuf);
+                m_CursorConn.block();
+                m_Model->erase(i);
+                m_CursorConn.unblock();
             }
+            void insert(const size_t i) { m_Model->insert(i); }
 
-            // Member ordering here is important, m_ListStore requires m_Columns
-            // during initialization
             ModelColumns m_Columns;
-            Glib::RefPtr<Gtk::ListStore> m_ListStore;
+            Glib::RefPtr<ThumbnailModel> m_Model;
 
         protected:
+            // Called around bulk changes to the model, the view should unset and set its
+            // model
+            virtual void detach_model() { }
+            virtual void attach_model() { }
+
             SignalSelectedChangedType m_SignalSelectedChanged;
+            sigc::signal<void> m_SignalVisibleRangeChanged;
             sigc::connection m_CursorConn;
         };
         // }}}
@@ -112,9 +178,22 @@ namespace AhoViewer
         virtual size_t get_size() const { return m_Images.size(); }
 
         size_t get_index() const { return m_Index; }
+        // Sets index to the position of the image with the given path, returns false if
+        // there isn't one.  Only local image lists keep track of paths
+        bool get_index_of(const std::string& path, size_t& index) const
+        {
+            auto it{ m_PathIndex.find(path) };
+            if (it == m_PathIndex.end())
+                return false;
+
+            index = it->second;
+            return true;
+        }
         const std::shared_ptr<Image>& get_current() const { return m_Images[m_Index]; }
         const Archive& get_archive() const { return *m_Archive; }
         bool empty() const { return m_Images.empty(); }
+        // True while the rest of the directory is being read after opening a file
+        bool is_loading() const { return m_LoadThread.joinable(); }
         bool from_archive() const { return !!m_Archive; }
 
         void set_scroll_position(const ScrollPos& s) { m_ScrollPos = s; }
@@ -127,21 +206,37 @@ namespace AhoViewer
         ImageVector::iterator end() { return m_Images.end(); }
 
         void on_cache_size_changed();
+        // The images next to the current one are scaled ahead of time to the fit size,
+        // this scales them again once it stops changing
+        void on_fit_size_changed();
+
+        // Number of bytes used by decoded images in every image list's cache
+        static size_t get_total_cache_memory_size() { return TotalCacheMemorySize; }
 
         SignalChangedType signal_changed() const { return m_SignalChanged; }
         SignalArchiveErrorType signal_archive_error() const { return m_SignalArchiveError; }
         sigc::signal<void> signal_cleared() const { return m_SignalCleared; }
         sigc::signal<void> signal_load_success() const { return m_SignalLoadSuccess; }
+        SignalLoadProgressType signal_load_progress() const { return m_SignalLoadProgress; }
+        sigc::signal<void> signal_load_finished() const { return m_SignalLoadFinished; }
         sigc::signal<void> signal_size_changed() const { return m_SignalSizeChanged; }
         sigc::signal<void> signal_thumbnails_loaded() const { return m_SignalThumbnailsLoaded; }
 
     protected:
-        virtual void load_thumbnails();
+        // Collects the rows without a thumbnail and starts m_ThumbnailThread to load them
+        void start_thumbnail_thread();
+        virtual void load_thumbnails(const std::vector<size_t>& pending);
         virtual void cancel_thumbnail_thread();
+        // Cancels m_ThumbnailCancel and every thumbnail that is being loaded
+        void cancel_thumbnail_jobs();
+        // Called when m_Index changes, the thumbnails closest to it are loaded first
+        void reprioritize_thumbnails();
         void update_cache();
 
         Widget* const m_Widget;
         ImageVector m_Images;
+        // Changed by the GUI thread with m_ThumbnailMutex held, get_thumbnail_priority reads
+        // it on the thumbnail thread
         size_t m_Index{ 0 };
 
         ScrollPos m_ScrollPos;
@@ -149,44 +244,158 @@ namespace AhoViewer
         Glib::RefPtr<Gio::Cancellable> m_ThumbnailCancel;
         std::thread m_ThumbnailThread;
         ThreadPool m_ThreadPool;
-        TSQueue<PixbufPair> m_ThumbnailQueue;
+        TSQueue<ThumbnailItem> m_ThumbnailQueue;
 
         SignalChangedType m_SignalChanged;
         sigc::signal<void> m_SignalCleared;
 
     private:
         void reset();
+        void load_directory(const std::string dir_path, const std::shared_ptr<Image> image);
+        void cancel_load();
+        void on_directory_loaded();
         template<typename T>
         std::vector<std::string> get_entries(const std::string& path) const;
 
+        void queue_thumbnails(const std::vector<size_t>& indices);
+        void thumbnail_worker();
+        bool pop_thumbnail(size_t& index,
+                           std::shared_ptr<Image>& image,
+                           Glib::RefPtr<Gio::Cancellable>& cancellable);
+        void update_thumbnail_indices(const ImageVector& old_images);
+        ThumbnailPriority get_thumbnail_priority(const size_t index) const;
         void on_thumbnail_loaded();
+        bool on_thumbnail_tick(const Glib::RefPtr<Gdk::FrameClock>&);
+        void cancel_thumbnail_flush();
+        void flush_thumbnails();
+        void on_visible_range_changed();
         void on_directory_changed(const Glib::RefPtr<Gio::File>& file,
                                   const Glib::RefPtr<Gio::File>&,
                                   Gio::FileMonitorEvent event);
+        bool on_directory_events();
+        void validate_images(std::vector<std::string> paths);
+        void cancel_directory_events();
+        void on_images_validated();
+        void insert_images(const ImageVector& images);
+        void erase_images(const std::vector<std::string>& paths);
+        void update_path_index();
+        bool find_image(const std::shared_ptr<Image>& image, size_t& index) const;
+        void restore_cache(const ImageVector& cached);
 
         void set_current_relative(const int d);
+        void update_navigation(const size_t index);
+        bool is_reading_fast() const;
+        size_t get_prefetch_distance(const size_t index) const;
+        size_t get_cache_window_size() const;
+        std::vector<size_t> get_cache_window() const;
+        void cache_thread();
+        void queue_cache();
         void cancel_cache();
+        void cancel_cache_image(const std::shared_ptr<Image>& img);
+        void free_cache_image(const std::shared_ptr<Image>& img);
+        void trim_cache();
+        void update_cache_memory_size();
+        void on_cache_loaded();
+
+        static std::atomic<size_t> TotalCacheMemorySize;
+
+        // Navigating one image at a time this many times in a row, each within
+        // FastNavigationInterval of the last, is considered reading quickly
+        static constexpr unsigned int FastNavigationStreak{ 3 };
+        static constexpr std::chrono::milliseconds FastNavigationInterval{ 1500 };
+        // Time to wait for the fit size to stop changing, e.g. while resizing the window
+        static constexpr unsigned int FitSizeDelay{ 250 };
+        // Number of images found between each load progress update
+        static constexpr size_t LoadProgressInterval{ 4096 };
+        // File monitor events are collected for this long and then handled together
+        static constexpr unsigned int DirectoryEventDelay{ 200 };
 
         // Indicies of the Images in the current cache
         std::vector<size_t> m_Cache;
+        // Images that have left the cache window but are kept decoded while they fit
+        // within the memory limit, most recently used first
+        std::list<std::shared_ptr<Image>> m_RecentCache;
         // A queue of Images that need to be loaded
-        TSQueue<std::shared_ptr<Image>> m_CacheQueue;
+        TSQueue<CacheItem> m_CacheQueue;
+        // Each image that is queued or being loaded can be cancelled on its own
+        std::map<std::shared_ptr<Image>, Glib::RefPtr<Gio::Cancellable>> m_CacheCancellables;
+        // Images currently being loaded by a cache thread and their size before loading,
+        // guarded by m_CacheMutex
+        std::map<std::shared_ptr<Image>, size_t> m_CacheLoading;
+        // Images the cache threads have finished loading
+        TSQueue<CacheItem> m_CacheLoadedQueue;
+        // Bytes used by the images in m_Cache, this is also updated by the cache thread
+        // as images finish loading.  Only written with m_CacheMutex held
+        std::atomic<size_t> m_CacheMemorySize{ 0 };
+        // Bytes used by the images in m_RecentCache, and the amount this image list
+        // has added to TotalCacheMemorySize
+        size_t m_RecentCacheMemorySize{ 0 }, m_AccountedMemorySize{ 0 };
         std::unique_ptr<Archive> m_Archive;
         std::vector<std::string> m_ArchiveEntries;
-        std::function<int(size_t, size_t)> m_IndexSort;
 
-        Glib::RefPtr<Gio::Cancellable> m_CacheCancel;
+        // Thumbnails waiting to be loaded, and the images whose thumbnails are being loaded
+        // each with its own cancellable.  Jobs are only cancelled when their image is
+        // removed or the list is reset, images moving to a new index keep loading.  These
+        // and the members below are guarded by m_ThumbnailMutex, which is also held while
+        // m_Images is changed after loading
+        PriorityQueue<ThumbnailPriority> m_ThumbnailPending;
+        std::map<std::shared_ptr<Image>, Glib::RefPtr<Gio::Cancellable>> m_ThumbnailLoading;
+        // Thread pool tasks that are running thumbnail_worker
+        size_t m_ThumbnailWorkers{ 0 };
+        // The range of thumbnails in view in m_Widget and the direction it was last
+        // scrolled, thumbnails are loaded in that order
+        bool m_HasVisibleRange{ false };
+        size_t m_VisibleFirst{ 0 }, m_VisibleLast{ 0 };
+        int m_ScrollDirection{ 1 };
+
+        // Direction of the last navigation (1 forward, -1 backward, 0 none yet) and the
+        // number of consecutive quick single steps in that direction.  Like m_Index they are
+        // changed with m_ThumbnailMutex held
+        int m_Direction{ 0 };
+        unsigned int m_Streak{ 0 };
+        std::chrono::steady_clock::time_point m_LastNavigation;
+
         std::atomic<bool> m_CacheStop{ false };
         std::condition_variable m_CacheCond;
         std::mutex m_CacheMutex, m_ThumbnailMutex;
-        std::thread m_CacheThread;
+        std::vector<std::thread> m_CacheThreads;
         Glib::RefPtr<Gio::FileMonitor> m_FileMonitor;
 
-        Glib::Dispatcher m_SignalThumbnailLoaded;
-
-        sigc::connection m_ThumbnailLoadedConn;
+        // When a file is opened it is shown right away while m_LoadThread reads, filters
+        // and sorts the rest of the directory.  The result is stored in m_LoadedImages
+        // with m_LoadMutex held and then replaces m_Images on the main thread
+        std::thread m_LoadThread;
+        std::atomic<bool> m_LoadCancel{ false };
+        std::atomic<size_t> m_LoadCount{ 0 };
+        std::mutex m_LoadMutex;
+        ImageVector m_LoadedImages;
+        size_t m_LoadedIndex{ 0 };
+        bool m_Loaded{ false };
+        Glib::Dispatcher m_SignalLoadProgressDisp, m_SignalLoadedDisp;
+
+        // Position of each image in m_Images by path
+        std::unordered_map<std::string, size_t> m_PathIndex;
+        // File monitor events waiting to be handled, true if the path was created and
+        // false if it was deleted.  Created files are validated by m_DirectoryThread which
+        // stores the valid ones in m_DirectoryImages, they are added to the list once it
+        // has finished
+        std::unordered_map<std::string, bool> m_DirectoryEvents;
+        std::thread m_DirectoryThread;
+        std::atomic<bool> m_DirectoryCancel{ false };
+        ImageVector m_DirectoryImages;
+        Glib::Dispatcher m_SignalImagesValidated;
+        sigc::connection m_DirectoryEventConn;
+
+        Glib::Dispatcher m_SignalThumbnailLoaded, m_SignalCacheLoaded;
+
+        // Set when flush_thumbnails is waiting for the next frame
+        bool m_ThumbnailFlushQueued{ false };
+        guint m_ThumbnailTickId{ 0 };
+        sigc::connection m_ThumbnailLoadedConn, m_ThumbnailIdleConn, m_FitSizeConn;
 
         SignalArchiveErrorType m_SignalArchiveError;
-        sigc::signal<void> m_SignalLoadSuccess, m_SignalSizeChanged, m_SignalThumbnailsLoaded;
+        SignalLoadProgressType m_SignalLoadProgress;
+        sigc::signal<void> m_SignalLoadSuccess, m_SignalLoadFinished, m_SignalSizeChanged,
+            m_SignalThumbnailsLoaded;
     };
 }
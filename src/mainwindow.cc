@@ -63,6 +63,14 @@ MainWindow::MainWindow(BaseObjectType* cobj, Glib::RefPtr<Gtk::Builder> bldr)
         [&](const std::string e) { m_StatusBar->set_message(e); });
     m_LocalImageList->signal_load_success().connect(
         [&]() { set_active_imagelist(m_LocalImageList); });
+    m_LocalImageList->signal_load_progress().connect([&](const size_t n) {
+        m_StatusBar->pulse_progress(Glib::ustring::compose(
+            ngettext("Loading directory (%1 image)", "Loading directory (%1 images)", n), n));
+    });
+    m_LocalImageList->signal_load_finished().connect([&]() {
+        m_StatusBar->clear_progress(StatusBar::Priority::MESSAGE);
+        m_StatusBar->clear_message(StatusBar::Priority::MESSAGE);
+    });
     m_LocalImageList->signal_size_changed().connect([&]() {
         if (m_LocalImageList == m_ActiveImageList)
         {
@@ -81,6 +89,10 @@ MainWindow::MainWindow(BaseObjectType* cobj, Glib::RefPtr<Gtk::Builder> bldr)
     m_ImageBox->signal_image_drawn().connect(sigc::mem_fun(*this, &MainWindow::update_title));
     m_ImageBox->signal_slideshow_ended().connect(
         sigc::mem_fun(*this, &MainWindow::on_toggle_slideshow));
+    m_ImageBox->signal_fit_size_changed().connect([&]() {
+        if (m_ActiveImageList)
+            m_ActiveImageList->on_fit_size_changed();
+    });
 
     m_PreferencesDialog->signal_bg_color_set().connect(
         sigc::mem_fun(m_ImageBox, &ImageBox::update_background_color));
@@ -90,6 +102,13 @@ MainWindow::MainWindow(BaseObjectType* cobj, Glib::RefPtr<Gtk::Builder> bldr)
         sigc::mem_fun(m_ImageBox, &ImageBox::cursor_timeout));
     m_PreferencesDialog->signal_cache_size_changed().connect(
         sigc::mem_fun(*this, &MainWindow::on_cache_size_changed));
+    m_PreferencesDialog->signal_cache_memory_changed().connect(
+        sigc::mem_fun(*this, &MainWindow::on_cache_size_changed));
+    m_PreferencesDialog->signal_scaling_filter_changed().connect([&]() {
+        m_ImageBox->queue_draw_image();
+        if (m_ActiveImageList)
+            m_ActiveImageList->on_fit_size_changed();
+    });
     m_PreferencesDialog->signal_slideshow_delay_changed().connect(
         sigc::mem_fun(m_ImageBox, &ImageBox::reset_slideshow));
     m_PreferencesDialog->get_site_editor()->signal_edited().connect(
@@ -229,13 +248,10 @@ void MainWindow::open_file(const std::string& path, const int index, const bool
     // Check if this image list is already loaded,
     // no point in reloading it since there are dirwatches setup
     // just change the current image in the list
-    auto iter{ std::find_if(
-        m_LocalImageList->begin(), m_LocalImageList->end(), [&absolute_path](const auto i) {
-            return i->get_path() == absolute_path;
-        }) };
-    if (iter != m_LocalImageList->end())
+    size_t local_index;
+    if (m_LocalImageList->get_index_of(absolute_path, local_index))
     {
-        m_LocalImageList->set_current(iter - m_LocalImageList->begin());
+        m_LocalImageList->set_current(local_index);
         set_active_imagelist(m_LocalImageList);
     }
     // Dont waste time re-extracting the archive just go to the first image
@@ -324,7 +340,7 @@ void MainWindow::on_check_resize()
 
     // Make sure we really need to redraw
     if (w != m_Width || h != m_Height)
-        m_ImageBox->queue_draw_image();
+        m_ImageBox->queue_draw_image_fast();
 
     m_Width  = w;
     m_Height = h;
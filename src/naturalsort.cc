@@ -0,0 +1,178 @@
+#include "naturalsort.h"
+using namespace AhoViewer;
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <climits>
+#include <cstddef>
+#include <future>
+#include <thread>
+
+// Key layout, each token of the string is encoded as
+//   number:  0x00, the number of bytes in its value, then the value big endian
+//   letter:  its rank among every possible lowercased letter, 1 - 246
+// and the key ends with 0xff.  Numbers sort before letters, and the end of the string
+// after both, matching the order of the recursive comparison this replaced.  Numbers
+// saturate at ULONG_MAX like strtoul did
+namespace
+{
+    constexpr unsigned char NumberTag{ 0x00 }, EndTag{ 0xff };
+
+    // Letters are compared by their std::tolower value, which can depend on the locale,
+    // so the ranks are built from it once.  NUL and digits are never letters, which leaves
+    // at most 245 distinct values
+    const std::array<unsigned char, 256>& get_letter_ranks()
+    {
+        static const std::array<unsigned char, 256> ranks{ []() {
+            std::vector<int> values;
+            for (int i = CHAR_MIN; i <= CHAR_MAX; ++i)
+                if (i != 0 && !std::isdigit(static_cast<char>(i)))
+                    values.push_back(std::tolower(static_cast<char>(i)));
+
+            std::sort(values.begin(), values.end());
+            values.erase(std::unique(values.begin(), values.end()), values.end());
+
+            std::array<unsigned char, 256> r{};
+            for (int i = CHAR_MIN; i <= CHAR_MAX; ++i)
+            {
+                if (i == 0 || std::isdigit(static_cast<char>(i)))
+                    continue;
+
+                auto it{ std::lower_bound(
+                    values.begin(), values.end(), std::tolower(static_cast<char>(i))) };
+                r[static_cast<unsigned char>(i)] = it - values.begin() + 1;
+            }
+
+            return r;
+        }() };
+
+        return ranks;
+    }
+
+    // Runs func(begin, end) over n items split between threads
+    template<typename T>
+    void parallel_for(const size_t n, const unsigned int threads, T&& func)
+    {
+        std::vector<std::future<void>> futures;
+        const size_t chunk{ (n + threads - 1) / threads };
+
+        for (size_t begin = chunk; begin < n; begin += chunk)
+            futures.push_back(
+                std::async(std::launch::async, func, begin, std::min(begin + chunk, n)));
+
+        func(0, std::min(chunk, n));
+
+        for (auto& f : futures)
+            f.get();
+    }
+
+    // When cancel is given the range is also split on a single thread, so it is checked
+    // at least every CancelBlockSize items.  Returns false if it was cancelled
+    constexpr ptrdiff_t CancelBlockSize{ 16384 };
+
+    template<typename It, typename Compare>
+    bool parallel_sort(It first,
+                       It last,
+                       Compare comp,
+                       const unsigned int threads,
+                       const std::atomic<bool>* cancel)
+    {
+        if (cancel && *cancel)
+            return false;
+
+        if (threads <= 1 && (!cancel || last - first <= CancelBlockSize))
+        {
+            std::sort(first, last, comp);
+            return true;
+        }
+
+        It mid{ first + (last - first) / 2 };
+        bool sorted;
+        if (threads > 1)
+        {
+            auto f{ std::async(std::launch::async, [&]() {
+                return parallel_sort(first, mid, comp, threads / 2, cancel);
+            }) };
+            sorted = parallel_sort(mid, last, comp, threads - threads / 2, cancel);
+            sorted = f.get() && sorted;
+        }
+        else
+        {
+            sorted = parallel_sort(first, mid, comp, 1, cancel) &&
+                     parallel_sort(mid, last, comp, 1, cancel);
+        }
+
+        if (!sorted || (cancel && *cancel))
+            return false;
+
+        std::inplace_merge(first, mid, last, comp);
+        return true;
+    }
+}
+
+NaturalSort::Key NaturalSort::make_key(const std::string& str)
+{
+    const auto& ranks{ get_letter_ranks() };
+    Key key;
+    key.reserve(str.size() + 1);
+
+    for (size_t i = 0; i < str.size() && str[i];)
+    {
+        if (!std::isdigit(str[i]))
+        {
+            key.push_back(ranks[static_cast<unsigned char>(str[i++])]);
+            continue;
+        }
+
+        unsigned long n{ 0 };
+        for (; i < str.size() && std::isdigit(str[i]); ++i)
+        {
+            const unsigned long d = str[i] - '0';
+            n = n > (ULONG_MAX - d) / 10 ? ULONG_MAX : n * 10 + d;
+        }
+
+        unsigned char bytes[sizeof(n)];
+        size_t size{ 0 };
+        for (; n; n >>= 8)
+            bytes[size++] = n & 0xff;
+
+        key.push_back(NumberTag);
+        key.push_back(size);
+        while (size)
+            key.push_back(bytes[--size]);
+    }
+
+    key.push_back(EndTag);
+
+    return key;
+}
+
+bool NaturalSort::sort(std::vector<std::string>& strings, const std::atomic<bool>* cancel)
+{
+    const unsigned int threads{
+        strings.size() < ParallelThreshold
+            ? 1u
+            : std::clamp(std::thread::hardware_concurrency(), 1u, 8u)
+    };
+
+    std::vector<Item> items(strings.size());
+    parallel_for(strings.size(), threads, [&](const size_t begin, const size_t end) {
+        for (size_t i = begin; i < end; ++i)
+        {
+            if (cancel && (i - begin) % static_cast<size_t>(CancelBlockSize) == 0 && *cancel)
+                return;
+
+            items[i] = { make_key(strings[i]), std::move(strings[i]) };
+        }
+    });
+
+    if ((cancel && *cancel) ||
+        !parallel_sort(items.begin(), items.end(), std::less<>{}, threads, cancel))
+        return false;
+
+    for (size_t i = 0; i < items.size(); ++i)
+        strings[i] = std::move(items[i].second);
+
+    return true;
+}
@@ -2,62 +2,47 @@
 
 #include "image.h"
 
-#include <cctype>
-#include <cstdlib>
+#include <atomic>
+#include <string>
+#include <utility>
+#include <vector>
 
 namespace AhoViewer
 {
+    // Orders strings so the numbers in them are compared by value and letters are compared
+    // ignoring case.  A string sorts after any longer string it is a prefix of
     class NaturalSort
     {
     public:
-        bool operator()(const std::string& a, const std::string& b)
+        // A string of bytes that compares (with std::string::compare, i.e. memcmp) in the
+        // same order the string it was made from compares with NaturalSort
+        using Key = std::string;
+        // A string and its key, items compare (with operator<) in the order sort() leaves
+        // their strings in
+        using Item = std::pair<Key, std::string>;
+
+        bool operator()(const std::string& a, const std::string& b) const
         {
-            return compare_natural(a.c_str(), b.c_str());
+            return make_item(a) < make_item(b);
         }
-        bool operator()(const std::shared_ptr<Image>& a, const std::shared_ptr<Image>& b)
+        bool operator()(const std::shared_ptr<Image>& a, const std::shared_ptr<Image>& b) const
         {
-            return compare_natural(a->get_path().c_str(), b->get_path().c_str());
+            return make_item(a->get_path()) < make_item(b->get_path());
         }
 
-    private:
-        bool compare_natural(const char* a, const char* b)
-        {
-            // End of string
-            if (!a || !b)
-                return !!a;
-
-            // Both are numbers, compare them as such
-            if (std::isdigit(*a) && std::isdigit(*b))
-            {
-                char *a_after, *b_after;
-                unsigned long a_l = strtoul(a, &a_after, 10), b_l = strtoul(b, &b_after, 10);
-
-                if (a_l != b_l)
-                    return a_l < b_l;
-
-                return compare_natural(a_after, b_after);
-            }
+        static Key make_key(const std::string& str);
+        static Item make_item(const std::string& str) { return { make_key(str), str }; }
 
-            // One of them is a number
-            if (std::isdigit(*a) || std::isdigit(*b))
-                return std::isdigit(*a);
+        // Sorts strings by their keys, each string is tokenized once.  Large vectors are
+        // split between threads.  Strings with equal keys (e.g. "07" and "7") are ordered
+        // by their bytes so the result doesn't depend on the number of threads.
+        // Returns false if cancel was set before it finished, strings is left in an
+        // unspecified state then
+        static bool sort(std::vector<std::string>& strings,
+                         const std::atomic<bool>* cancel = nullptr);
 
-            // Both of them are not numbers
-            while (*a && *b)
-            {
-                // Both letters were the same, are they numbers?
-                if (std::isdigit(*a) || std::isdigit(*b))
-                    return compare_natural(a, b);
-
-                // Both are letters but different letters
-                if (std::tolower(*a) != std::tolower(*b))
-                    return std::tolower(*a) < std::tolower(*b);
-
-                ++a;
-                ++b;
-            }
-
-            return !!*a;
-        }
+    private:
+        // Vectors smaller than this are sorted on the calling thread
+        static constexpr size_t ParallelThreshold{ 8192 };
     };
 }
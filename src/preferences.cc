@@ -1,6 +1,7 @@
 #include "preferences.h"
 using namespace AhoViewer;
 
+#include "imagelist.h"
 #include "settings.h"
 
 #include <glibmm/i18n.h>
@@ -10,6 +11,7 @@ PreferencesDialog::PreferencesDialog(BaseObjectType* cobj, const Glib::RefPtr<Gt
       m_SpinSignals({
           { "CursorHideDelay", sigc::signal<void>() },
           { "CacheSize", sigc::signal<void>() },
+          { "CacheMemory", sigc::signal<void>() },
           { "SlideshowDelay", sigc::signal<void>() },
       })
 {
@@ -65,7 +67,8 @@ PreferencesDialog::PreferencesDialog(BaseObjectType* cobj, const Glib::RefPtr<Gt
     std::vector<std::string> check_settings = {
         "StartFullscreen", "HideAllFullscreen",    "RememberWindowSize", "RememberWindowPos",
         "SmartNavigation", "AutoOpenArchive",      "RememberLastFile",   "StoreRecentFiles",
-        "SaveThumbnails",  "RememberLastSavePath", "SaveImageTags",
+        "SaveThumbnails",  "RememberLastSavePath", "SaveImageTags",      "DecodeAtFitSize",
+        "ThumbnailDatabase",
     };
 
     for (const std::string& s : check_settings)
@@ -81,6 +84,7 @@ PreferencesDialog::PreferencesDialog(BaseObjectType* cobj, const Glib::RefPtr<Gt
     std::vector<std::string> spin_settings = {
         "CursorHideDelay",
         "CacheSize",
+        "CacheMemory",
         "SlideshowDelay",
         "BooruLimit",
     };
@@ -99,9 +103,18 @@ PreferencesDialog::PreferencesDialog(BaseObjectType* cobj, const Glib::RefPtr<Gt
     }
     // }}}
 
+    // Only poll the cache memory usage while the dialog is visible
+    bldr->get_widget("CacheMemoryUsage", m_CacheMemoryUsage);
+    signal_show().connect([&]() {
+        update_cache_memory_usage();
+        m_CacheMemoryUsageConn = Glib::signal_timeout().connect(
+            sigc::mem_fun(*this, &PreferencesDialog::update_cache_memory_usage), 1000);
+    });
+    signal_hide().connect([&]() { m_CacheMemoryUsageConn.disconnect(); });
+
     Gtk::ComboBox* combo_box{ nullptr };
     bldr->get_widget("BooruMaxRating", combo_box);
-    BooruMaxRatingModelColumns columns;
+    ComboBoxModelColumns columns;
     Glib::RefPtr<Gtk::ListStore> combo_model = Gtk::ListStore::create(columns);
 
     std::vector<std::string> ratings = {
@@ -120,4 +133,34 @@ PreferencesDialog::PreferencesDialog(BaseObjectType* cobj, const Glib::RefPtr<Gt
         Settings.set_booru_max_rating(
             static_cast<Booru::Rating>(combo_box->get_active_row_number()));
     });
+
+    bldr->get_widget("ScalingFilter", combo_box);
+    combo_model = Gtk::ListStore::create(columns);
+
+    // Same order as ScalingFilter
+    std::vector<std::string> filters = {
+        _("Bilinear (GdkPixbuf)"),
+        _("Bilinear"),
+        _("Lanczos"),
+        _("Area"),
+    };
+
+    for (const std::string& filter : filters)
+        combo_model->append()->set_value(0, filter);
+
+    combo_box->pack_start(columns.text_column);
+    combo_box->set_model(combo_model);
+    combo_box->set_active(static_cast<int>(Settings.get_scaling_filter()));
+    combo_box->signal_changed().connect([&, combo_box]() {
+        Settings.set_scaling_filter(static_cast<ScalingFilter>(combo_box->get_active_row_number()));
+        m_SignalScalingFilterChanged();
+    });
+}
+
+bool PreferencesDialog::update_cache_memory_usage()
+{
+    m_CacheMemoryUsage->set_text(Glib::ustring::compose(
+        _("%1 currently in use"), Glib::format_size(ImageList::get_total_cache_memory_size())));
+
+    return true;
 }
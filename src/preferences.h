@@ -25,6 +25,10 @@ namespace AhoViewer
         {
             return m_SpinSignals.at("CacheSize");
         }
+        sigc::signal<void> signal_cache_memory_changed() const
+        {
+            return m_SpinSignals.at("CacheMemory");
+        }
         sigc::signal<void> signal_slideshow_delay_changed() const
         {
             return m_SpinSignals.at("SlideshowDelay");
@@ -33,18 +37,27 @@ namespace AhoViewer
         {
             return m_SignalTitleFormatChanged;
         }
+        sigc::signal<void> signal_scaling_filter_changed() const
+        {
+            return m_SignalScalingFilterChanged;
+        }
 
     private:
-        struct BooruMaxRatingModelColumns : public Gtk::TreeModelColumnRecord
+        struct ComboBoxModelColumns : public Gtk::TreeModelColumnRecord
         {
-            BooruMaxRatingModelColumns() { add(text_column); }
+            ComboBoxModelColumns() { add(text_column); }
             Gtk::TreeModelColumn<std::string> text_column;
         };
 
+        bool update_cache_memory_usage();
+
         SiteEditor* m_SiteEditor;
         KeybindingEditor* m_KeybindingEditor;
+        Gtk::Label* m_CacheMemoryUsage;
+        sigc::connection m_CacheMemoryUsageConn;
 
         const std::map<std::string, sigc::signal<void>> m_SpinSignals;
-        sigc::signal<void> m_SignalBGColorSet, m_SignalTitleFormatChanged;
+        sigc::signal<void> m_SignalBGColorSet, m_SignalTitleFormatChanged,
+            m_SignalScalingFilterChanged;
     };
 }
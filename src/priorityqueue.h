@@ -0,0 +1,144 @@
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace AhoViewer
+{
+    // A binary min heap of indices whose priorities can be changed while they are
+    // queued.  Each index can only be queued once and its position in the heap is
+    // tracked, so changing its priority or removing it is O(log n) instead of
+    // rebuilding the queue.  This is not thread safe
+    template<typename Priority>
+    class PriorityQueue
+    {
+    public:
+        bool empty() const { return m_Heap.empty(); }
+        size_t size() const { return m_Heap.size(); }
+        bool contains(const size_t index) const
+        {
+            return index < m_Positions.size() && m_Positions[index] != npos;
+        }
+
+        // Queues index, or changes its priority if it is already queued
+        void push(const size_t index, const Priority& priority)
+        {
+            if (contains(index))
+            {
+                const size_t pos{ m_Positions[index] };
+                m_Heap[pos].first = priority;
+                sift_down(sift_up(pos));
+                return;
+            }
+
+            if (index >= m_Positions.size())
+                m_Positions.resize(index + 1, npos);
+
+            m_Heap.emplace_back(priority, index);
+            m_Positions[index] = m_Heap.size() - 1;
+            sift_up(m_Heap.size() - 1);
+        }
+
+        // Removes the index with the lowest priority
+        bool pop(size_t& index)
+        {
+            if (m_Heap.empty())
+                return false;
+
+            index = m_Heap.front().second;
+            remove_at(0);
+
+            return true;
+        }
+
+        void erase(const size_t index)
+        {
+            if (contains(index))
+                remove_at(m_Positions[index]);
+        }
+
+        // Sets every priority to func(index) and restores the heap in O(n)
+        template<typename F>
+        void reprioritize(F&& func)
+        {
+            for (auto& [priority, index] : m_Heap)
+                priority = func(index);
+
+            for (size_t i = m_Heap.size() / 2; i-- > 0;)
+                sift_down(i);
+        }
+
+        void clear()
+        {
+            m_Heap.clear();
+            m_Positions.clear();
+        }
+
+    private:
+        void remove_at(const size_t pos)
+        {
+            m_Positions[m_Heap[pos].second] = npos;
+
+            if (pos + 1 == m_Heap.size())
+            {
+                m_Heap.pop_back();
+                return;
+            }
+
+            m_Heap[pos] = std::move(m_Heap.back());
+            m_Heap.pop_back();
+            m_Positions[m_Heap[pos].second] = pos;
+            sift_down(sift_up(pos));
+        }
+
+        size_t sift_up(size_t pos)
+        {
+            while (pos > 0)
+            {
+                const size_t parent{ (pos - 1) / 2 };
+                if (!(m_Heap[pos].first < m_Heap[parent].first))
+                    break;
+
+                swap_nodes(pos, parent);
+                pos = parent;
+            }
+
+            return pos;
+        }
+
+        void sift_down(size_t pos)
+        {
+            while (true)
+            {
+                const size_t left{ pos * 2 + 1 }, right{ left + 1 };
+                size_t smallest{ pos };
+
+                if (left < m_Heap.size() && m_Heap[left].first < m_Heap[smallest].first)
+                    smallest = left;
+                if (right < m_Heap.size() && m_Heap[right].first < m_Heap[smallest].first)
+                    smallest = right;
+
+                if (smallest == pos)
+                    break;
+
+                swap_nodes(pos, smallest);
+                pos = smallest;
+            }
+        }
+
+        void swap_nodes(const size_t a, const size_t b)
+        {
+            std::swap(m_Heap[a], m_Heap[b]);
+            m_Positions[m_Heap[a].second] = a;
+            m_Positions[m_Heap[b].second] = b;
+        }
+
+        static constexpr size_t npos{ std::numeric_limits<size_t>::max() };
+
+        std::vector<std::pair<Priority, size_t>> m_Heap;
+        // Position of each index in m_Heap, npos if it isn't queued
+        std::vector<size_t> m_Positions;
+    };
+}
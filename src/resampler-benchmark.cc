@@ -0,0 +1,119 @@
+// Compares the time it takes to scale an image with GdkPixbuf and each of the
+// Resampler filters.  Built when the benchmarks option is enabled and run with
+// meson test --benchmark, or directly with an optional image path
+#include "resampler.h"
+using namespace AhoViewer;
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+namespace
+{
+    constexpr int Iterations{ 5 };
+
+    Glib::RefPtr<Gdk::Pixbuf> create_test_pixbuf(const int w, const int h)
+    {
+        auto pixbuf{ Gdk::Pixbuf::create(Gdk::COLORSPACE_RGB, true, 8, w, h) };
+        guint8* pixels{ pixbuf->get_pixels() };
+
+        for (int y = 0; y < h; ++y)
+        {
+            guint8* row{ pixels + y * pixbuf->get_rowstride() };
+            for (int x = 0; x < w; ++x)
+            {
+                row[x * 4]     = x ^ y;
+                row[x * 4 + 1] = x * 3 + y;
+                row[x * 4 + 2] = (x / 8 + y / 8) % 2 ? 255 : 0;
+                row[x * 4 + 3] = 255 - (y & 127);
+            }
+        }
+
+        return pixbuf;
+    }
+
+    template<typename T>
+    void run(const char* name, T&& func)
+    {
+        using namespace std::chrono;
+        double best{ 0 };
+
+        for (int i = 0; i < Iterations; ++i)
+        {
+            auto start{ steady_clock::now() };
+            func();
+            double ms{ duration<double, std::milli>(steady_clock::now() - start).count() };
+            best = i == 0 ? ms : std::min(best, ms);
+        }
+
+        std::cout << std::setw(28) << std::left << name << std::fixed << std::setprecision(1)
+                  << best << " ms" << std::endl;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Gio::init();
+    Gdk::wrap_init();
+
+    Glib::RefPtr<Gdk::Pixbuf> src;
+    try
+    {
+        src = argc > 1 ? Gdk::Pixbuf::create_from_file(argv[1]) : create_test_pixbuf(6000, 4000);
+    }
+    catch (const Glib::Error& ex)
+    {
+        std::cerr << ex.what() << std::endl;
+        return 1;
+    }
+
+    if (!src->get_has_alpha())
+        src = src->add_alpha(false, 0, 0, 0);
+
+    std::cout << "Instruction set: " << Resampler::get_simd_name() << std::endl;
+
+    for (const double scale : { 0.32, 0.5, 1.5 })
+    {
+        const int w{ static_cast<int>(src->get_width() * scale) },
+            h{ static_cast<int>(src->get_height() * scale) };
+        auto dst{ Gdk::Pixbuf::create(Gdk::COLORSPACE_RGB, true, 8, w, h) };
+
+        std::cout << std::endl
+                  << src->get_width() << "x" << src->get_height() << " -> " << w << "x" << h
+                  << std::endl;
+
+        run("GdkPixbuf bilinear", [&]() { src->scale_simple(w, h, Gdk::INTERP_BILINEAR); });
+        run("GdkPixbuf hyper", [&]() { src->scale_simple(w, h, Gdk::INTERP_HYPER); });
+
+        for (auto [filter, name] : { std::pair{ ScalingFilter::BILINEAR, "bilinear" },
+                                     std::pair{ ScalingFilter::LANCZOS, "lanczos" },
+                                     std::pair{ ScalingFilter::AREA, "area" } })
+        {
+            for (const unsigned int threads : { 1u, 0u })
+            {
+                std::string label{ std::string{ name } +
+                                   (threads == 1 ? " (1 thread)" : " (threaded)") };
+                run(label.c_str(), [&]() {
+                    Resampler::scale_pixels(src->get_pixels(),
+                                            src->get_width(),
+                                            src->get_height(),
+                                            src->get_rowstride(),
+                                            dst->get_pixels(),
+                                            dst->get_rowstride(),
+                                            4,
+                                            w,
+                                            h,
+                                            0,
+                                            0,
+                                            w,
+                                            h,
+                                            filter,
+                                            threads);
+                });
+            }
+        }
+    }
+
+    return 0;
+}
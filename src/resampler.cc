@@ -0,0 +1,588 @@
+#include "resampler.h"
+using namespace AhoViewer;
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define RESAMPLER_X86 1
+#include <immintrin.h>
+#endif
+
+namespace
+{
+    // The source pixels that contribute to each destination pixel along one axis,
+    // and how much they contribute
+    struct Kernel
+    {
+        std::vector<int> start, count, offset;
+        std::vector<float> weights;
+        int max_count{ 0 };
+    };
+
+    // Pixels are unpacked to 4 floats with premultiplied alpha while filtering,
+    // RGB pixels get an alpha of 255
+    struct Ops
+    {
+        // Unpacks a row of w 8 bit pixels
+        void (*unpack_row)(const uint8_t* src, float* dst, const int w, const int channels);
+        // Filters a row of unpacked pixels horizontally into w pixels
+        void (*filter_row)(const float* src, float* dst, const Kernel& k, const int w);
+        // dst += src * weight, n is the number of floats and always a multiple of 4
+        void (*accumulate)(float* dst, const float* src, const float weight, const int n);
+        // Packs a row of w unpacked pixels back to 8 bits
+        void (*pack_row)(const float* src, uint8_t* dst, const int w, const int channels);
+        const char* name;
+    };
+
+    constexpr double Pi{ 3.14159265358979323846 };
+
+    double lanczos3(const double x)
+    {
+        if (x == 0)
+            return 1;
+        if (x <= -3 || x >= 3)
+            return 0;
+
+        const double px{ Pi * x };
+        return 3 * std::sin(px) * std::sin(px / 3) / (px * px);
+    }
+
+    // Builds the kernel for the destination pixels [offset, offset + size) of an axis
+    // that is scaled from src_size to full_size
+    Kernel make_kernel(const int src_size,
+                       const int full_size,
+                       const int offset,
+                       const int size,
+                       const ScalingFilter filter)
+    {
+        Kernel k;
+        const double scale{ static_cast<double>(full_size) / src_size },
+            // Widen the filter when scaling down so every source pixel is sampled
+            fscale{ std::max(1.0, 1.0 / scale) };
+        double support{ fscale };
+
+        if (filter == ScalingFilter::LANCZOS)
+            support = 3 * fscale;
+        else if (filter == ScalingFilter::AREA)
+            support = 0.5 * fscale + 0.5;
+
+        k.start.reserve(size);
+        k.count.reserve(size);
+        k.offset.reserve(size);
+
+        for (int i = 0; i < size; ++i)
+        {
+            const double center{ (offset + i + 0.5) / scale };
+            int left{ std::max(static_cast<int>(std::floor(center - support)), 0) },
+                right{ std::min(static_cast<int>(std::ceil(center + support)), src_size) };
+
+            std::vector<double> w;
+            double sum{ 0 };
+
+            for (int j = left; j < right; ++j)
+            {
+                double v;
+                if (filter == ScalingFilter::AREA)
+                    // How much of the source pixel is covered by the destination pixel
+                    v = std::max(std::min(j + 1.0, center + fscale / 2) -
+                                     std::max(static_cast<double>(j), center - fscale / 2),
+                                 0.0);
+                else if (filter == ScalingFilter::LANCZOS)
+                    v = lanczos3((j + 0.5 - center) / fscale);
+                else
+                    v = std::max(1 - std::abs((j + 0.5 - center) / fscale), 0.0);
+
+                w.push_back(v);
+                sum += v;
+            }
+
+            // Can only happen at the edges, use the nearest pixel
+            if (w.empty() || sum == 0)
+            {
+                left = std::clamp(static_cast<int>(center), 0, src_size - 1);
+                w.assign(1, 1.0);
+                sum = 1;
+            }
+
+            // Skip the pixels that don't contribute at all
+            size_t first{ 0 }, last{ w.size() };
+            while (first + 1 < last && w[first] == 0)
+                ++first;
+            while (last - 1 > first && w[last - 1] == 0)
+                --last;
+
+            k.start.push_back(left + first);
+            k.count.push_back(last - first);
+            k.offset.push_back(k.weights.size());
+            k.max_count = std::max(k.max_count, static_cast<int>(last - first));
+
+            for (size_t j = first; j < last; ++j)
+                k.weights.push_back(w[j] / sum);
+        }
+
+        return k;
+    }
+
+    // Scalar {{{
+    void unpack_row_scalar(const uint8_t* src, float* dst, const int w, const int channels)
+    {
+        for (int x = 0; x < w; ++x, src += channels, dst += 4)
+        {
+            const float a{ channels == 4 ? static_cast<float>(src[3]) : 255.0f },
+                m{ a / 255.0f };
+
+            dst[0] = src[0] * m;
+            dst[1] = src[1] * m;
+            dst[2] = src[2] * m;
+            dst[3] = a;
+        }
+    }
+
+    void filter_row_scalar(const float* src, float* dst, const Kernel& k, const int w)
+    {
+        for (int x = 0; x < w; ++x, dst += 4)
+        {
+            const float *s{ src + k.start[x] * 4 }, *wt{ &k.weights[k.offset[x]] };
+            float r{ 0 }, g{ 0 }, b{ 0 }, a{ 0 };
+
+            for (int j = 0; j < k.count[x]; ++j, s += 4)
+            {
+                r += s[0] * wt[j];
+                g += s[1] * wt[j];
+                b += s[2] * wt[j];
+                a += s[3] * wt[j];
+            }
+
+            dst[0] = r;
+            dst[1] = g;
+            dst[2] = b;
+            dst[3] = a;
+        }
+    }
+
+    void accumulate_scalar(float* dst, const float* src, const float weight, const int n)
+    {
+        for (int i = 0; i < n; ++i)
+            dst[i] += src[i] * weight;
+    }
+
+    void pack_row_scalar(const float* src, uint8_t* dst, const int w, const int channels)
+    {
+        static auto to_byte = [](const float v) {
+            return static_cast<uint8_t>(std::clamp(v + 0.5f, 0.0f, 255.0f));
+        };
+
+        for (int x = 0; x < w; ++x, src += 4, dst += channels)
+        {
+            const float a{ std::clamp(src[3], 0.0f, 255.0f) },
+                m{ a > 0 ? 255.0f / a : 0.0f };
+
+            dst[0] = to_byte(src[0] * m);
+            dst[1] = to_byte(src[1] * m);
+            dst[2] = to_byte(src[2] * m);
+            if (channels == 4)
+                dst[3] = to_byte(a);
+        }
+    }
+    // }}}
+
+#ifdef RESAMPLER_X86
+    // SSE2 {{{
+    __attribute__((target("sse2"))) void
+    unpack_row_sse2(const uint8_t* src, float* dst, const int w, const int channels)
+    {
+        const __m128i zero{ _mm_setzero_si128() };
+        const __m128 inv255{ _mm_set1_ps(1.0f / 255.0f) },
+            rgb_mask{ _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1)) },
+            alpha_one{ _mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f) };
+
+        for (int x = 0; x < w; ++x, src += channels, dst += 4)
+        {
+            int32_t v;
+            if (channels == 4)
+                std::memcpy(&v, src, 4);
+            else
+                v = src[0] | src[1] << 8 | src[2] << 16 | 0xFF << 24;
+
+            __m128 px{ _mm_cvtepi32_ps(
+                _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(v), zero), zero)) };
+
+            if (channels == 4)
+            {
+                // Multiply the color by alpha / 255 and the alpha by 1
+                __m128 a{ _mm_mul_ps(_mm_shuffle_ps(px, px, _MM_SHUFFLE(3, 3, 3, 3)), inv255) };
+                px = _mm_mul_ps(px, _mm_or_ps(_mm_and_ps(a, rgb_mask), alpha_one));
+            }
+
+            _mm_storeu_ps(dst, px);
+        }
+    }
+
+    __attribute__((target("sse2"))) void
+    filter_row_sse2(const float* src, float* dst, const Kernel& k, const int w)
+    {
+        for (int x = 0; x < w; ++x, dst += 4)
+        {
+            const float *s{ src + k.start[x] * 4 }, *wt{ &k.weights[k.offset[x]] };
+            __m128 acc{ _mm_setzero_ps() };
+
+            for (int j = 0; j < k.count[x]; ++j, s += 4)
+                acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(s), _mm_set1_ps(wt[j])));
+
+            _mm_storeu_ps(dst, acc);
+        }
+    }
+
+    __attribute__((target("sse2"))) void
+    accumulate_sse2(float* dst, const float* src, const float weight, const int n)
+    {
+        const __m128 w{ _mm_set1_ps(weight) };
+
+        for (int i = 0; i < n; i += 4)
+            _mm_storeu_ps(dst + i,
+                          _mm_add_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(_mm_loadu_ps(src + i), w)));
+    }
+
+    __attribute__((target("sse2"))) void
+    pack_row_sse2(const float* src, uint8_t* dst, const int w, const int channels)
+    {
+        const __m128 zero{ _mm_setzero_ps() }, max{ _mm_set1_ps(255.0f) },
+            rgb_mask{ _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1)) },
+            alpha_one{ _mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f) };
+
+        for (int x = 0; x < w; ++x, src += 4, dst += channels)
+        {
+            __m128 px{ _mm_loadu_ps(src) },
+                a{ _mm_min_ps(_mm_max_ps(_mm_shuffle_ps(px, px, _MM_SHUFFLE(3, 3, 3, 3)), zero),
+                              max) },
+                // 255 / alpha, or 0 when alpha is 0
+                m{ _mm_and_ps(_mm_div_ps(max, a), _mm_cmpgt_ps(a, zero)) };
+
+            px = _mm_mul_ps(px, _mm_or_ps(_mm_and_ps(m, rgb_mask), alpha_one));
+
+            // Round and saturate to 8 bits
+            __m128i i{ _mm_cvtps_epi32(px) };
+            i = _mm_packus_epi16(_mm_packs_epi32(i, i), i);
+
+            const int32_t v{ _mm_cvtsi128_si32(i) };
+            std::memcpy(dst, &v, channels);
+        }
+    }
+    // }}}
+
+    // AVX2 {{{
+    // Two pixels are handled at a time, one in each 128 bit lane.  Odd pixels left over at
+    // the end of a row use the SSE2 functions
+    __attribute__((target("avx2"))) void
+    unpack_row_avx2(const uint8_t* src, float* dst, const int w, const int channels)
+    {
+        const __m256 inv255{ _mm256_set1_ps(1.0f / 255.0f) },
+            rgb_mask{ _mm256_castsi256_ps(_mm256_set_epi32(0, -1, -1, -1, 0, -1, -1, -1)) },
+            alpha_one{ _mm256_set_ps(1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f) };
+        int x{ 0 };
+
+        for (; x + 2 <= w; x += 2, src += channels * 2, dst += 8)
+        {
+            __m128i v;
+            if (channels == 4)
+                v = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src));
+            else
+                v = _mm_set_epi32(0,
+                                  0,
+                                  src[3] | src[4] << 8 | src[5] << 16 | 0xFF << 24,
+                                  src[0] | src[1] << 8 | src[2] << 16 | 0xFF << 24);
+
+            __m256 px{ _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(v)) };
+
+            if (channels == 4)
+            {
+                // Multiply the color by alpha / 255 and the alpha by 1
+                __m256 a{ _mm256_mul_ps(_mm256_permute_ps(px, _MM_SHUFFLE(3, 3, 3, 3)), inv255) };
+                px = _mm256_mul_ps(px, _mm256_or_ps(_mm256_and_ps(a, rgb_mask), alpha_one));
+            }
+
+            _mm256_storeu_ps(dst, px);
+        }
+
+        if (x < w)
+            unpack_row_sse2(src, dst, w - x, channels);
+    }
+
+    // The taps of each pixel are summed two at a time, then the lanes are added together
+    __attribute__((target("avx2"))) void
+    filter_row_avx2(const float* src, float* dst, const Kernel& k, const int w)
+    {
+        for (int x = 0; x < w; ++x, dst += 4)
+        {
+            const float *s{ src + k.start[x] * 4 }, *wt{ &k.weights[k.offset[x]] };
+            const int count{ k.count[x] };
+            __m256 acc{ _mm256_setzero_ps() };
+            int j{ 0 };
+
+            for (; j + 2 <= count; j += 2, s += 8)
+            {
+                const __m256 weights{ _mm256_insertf128_ps(
+                    _mm256_castps128_ps256(_mm_set1_ps(wt[j])), _mm_set1_ps(wt[j + 1]), 1) };
+                acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(s), weights));
+            }
+
+            __m128 sum{ _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1)) };
+            if (j < count)
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(s), _mm_set1_ps(wt[j])));
+
+            _mm_storeu_ps(dst, sum);
+        }
+    }
+
+    __attribute__((target("avx2"))) void
+    accumulate_avx2(float* dst, const float* src, const float weight, const int n)
+    {
+        const __m256 w{ _mm256_set1_ps(weight) };
+        int i{ 0 };
+
+        for (; i + 8 <= n; i += 8)
+            _mm256_storeu_ps(
+                dst + i,
+                _mm256_add_ps(_mm256_loadu_ps(dst + i), _mm256_mul_ps(_mm256_loadu_ps(src + i), w)));
+
+        if (i < n)
+            accumulate_sse2(dst + i, src + i, weight, n - i);
+    }
+
+    __attribute__((target("avx2"))) void
+    pack_row_avx2(const float* src, uint8_t* dst, const int w, const int channels)
+    {
+        const __m256 zero{ _mm256_setzero_ps() }, max{ _mm256_set1_ps(255.0f) },
+            rgb_mask{ _mm256_castsi256_ps(_mm256_set_epi32(0, -1, -1, -1, 0, -1, -1, -1)) },
+            alpha_one{ _mm256_set_ps(1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f) };
+        int x{ 0 };
+
+        for (; x + 2 <= w; x += 2, src += 8, dst += channels * 2)
+        {
+            __m256 px{ _mm256_loadu_ps(src) },
+                a{ _mm256_min_ps(
+                    _mm256_max_ps(_mm256_permute_ps(px, _MM_SHUFFLE(3, 3, 3, 3)), zero), max) },
+                // 255 / alpha, or 0 when alpha is 0
+                m{ _mm256_and_ps(_mm256_div_ps(max, a), _mm256_cmp_ps(a, zero, _CMP_GT_OQ)) };
+
+            px = _mm256_mul_ps(px, _mm256_or_ps(_mm256_and_ps(m, rgb_mask), alpha_one));
+
+            // Round and saturate to 8 bits, the packs work within each lane so each pixel
+            // ends up in the low 4 bytes of its lane
+            __m256i i{ _mm256_cvtps_epi32(px) };
+            i = _mm256_packus_epi16(_mm256_packs_epi32(i, i), i);
+
+            const int32_t v0{ _mm_cvtsi128_si32(_mm256_castsi256_si128(i)) },
+                v1{ _mm_cvtsi128_si32(_mm256_extracti128_si256(i, 1)) };
+            std::memcpy(dst, &v0, channels);
+            std::memcpy(dst + channels, &v1, channels);
+        }
+
+        if (x < w)
+            pack_row_sse2(src, dst, w - x, channels);
+    }
+    // }}}
+#endif // RESAMPLER_X86
+
+    const Ops& get_ops()
+    {
+        static const Ops ops{ []() -> Ops {
+#ifdef RESAMPLER_X86
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2"))
+                return { unpack_row_avx2, filter_row_avx2, accumulate_avx2, pack_row_avx2, "AVX2" };
+            if (__builtin_cpu_supports("sse2"))
+                return { unpack_row_sse2, filter_row_sse2, accumulate_sse2, pack_row_sse2, "SSE2" };
+#endif // RESAMPLER_X86
+            return {
+                unpack_row_scalar, filter_row_scalar, accumulate_scalar, pack_row_scalar, "scalar"
+            };
+        }() };
+
+        return ops;
+    }
+
+    // Scales the destination rows [y0, y1).  Horizontally filtered source rows are kept in a
+    // ring buffer that is large enough for the vertical filter, so each source row is only
+    // filtered once
+    void scale_rows(const uint8_t* src,
+                    const int src_stride,
+                    const int src_x,
+                    const int src_w,
+                    uint8_t* dst,
+                    const int dst_stride,
+                    const int channels,
+                    const int w,
+                    const Kernel& kx,
+                    const Kernel& ky,
+                    const int y0,
+                    const int y1)
+    {
+        const Ops& ops{ get_ops() };
+        const int ring_size{ ky.max_count }, row_size{ w * 4 };
+
+        std::vector<float> unpacked(src_w * 4), ring(ring_size * row_size), acc(row_size);
+        std::vector<int> ring_rows(ring_size, -1);
+
+        for (int y = y0; y < y1; ++y)
+        {
+            std::fill(acc.begin(), acc.end(), 0.0f);
+
+            for (int j = 0; j < ky.count[y]; ++j)
+            {
+                const int row{ ky.start[y] + j }, slot{ row % ring_size };
+                float* filtered{ &ring[slot * row_size] };
+
+                if (ring_rows[slot] != row)
+                {
+                    ops.unpack_row(src + static_cast<size_t>(row) * src_stride + src_x * channels,
+                                   unpacked.data(),
+                                   src_w,
+                                   channels);
+                    ops.filter_row(unpacked.data(), filtered, kx, w);
+                    ring_rows[slot] = row;
+                }
+
+                ops.accumulate(acc.data(), filtered, ky.weights[ky.offset[y] + j], row_size);
+            }
+
+            ops.pack_row(acc.data(), dst + static_cast<size_t>(y) * dst_stride, w, channels);
+        }
+    }
+}
+
+void Resampler::scale_pixels(const uint8_t* src,
+                             const int src_w,
+                             const int src_h,
+                             const int src_stride,
+                             uint8_t* dst,
+                             const int dst_stride,
+                             const int channels,
+                             const int full_w,
+                             const int full_h,
+                             const int x,
+                             const int y,
+                             const int w,
+                             const int h,
+                             const ScalingFilter filter,
+                             unsigned int n_threads)
+{
+    if (w <= 0 || h <= 0 || src_w <= 0 || src_h <= 0)
+        return;
+
+    Kernel kx{ make_kernel(src_w, full_w, x, w, filter) },
+        ky{ make_kernel(src_h, full_h, y, h, filter) };
+
+    // Only unpack the source columns that are needed
+    const int src_x{ *std::min_element(kx.start.begin(), kx.start.end()) };
+    int src_end{ 0 };
+    for (int i = 0; i < w; ++i)
+    {
+        kx.start[i] -= src_x;
+        src_end = std::max(src_end, src_x + kx.start[i] + kx.count[i]);
+    }
+
+    // Small images aren't worth starting threads for
+    if (n_threads == 0)
+        n_threads = std::clamp(static_cast<unsigned int>(static_cast<int64_t>(w) * h / 65536),
+                               1u,
+                               std::max(std::thread::hardware_concurrency(), 1u));
+    n_threads = std::min(n_threads, static_cast<unsigned int>(h));
+
+    auto run = [&](const int y0, const int y1) {
+        scale_rows(src,
+                   src_stride,
+                   src_x,
+                   src_end - src_x,
+                   dst,
+                   dst_stride,
+                   channels,
+                   w,
+                   kx,
+                   ky,
+                   y0,
+                   y1);
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned int i = 1; i < n_threads; ++i)
+        threads.emplace_back(run, h * i / n_threads, h * (i + 1) / n_threads);
+
+    run(0, h / n_threads);
+
+    for (auto& t : threads)
+        t.join();
+}
+
+Glib::RefPtr<Gdk::Pixbuf> Resampler::scale(const Glib::RefPtr<Gdk::Pixbuf>& pixbuf,
+                                           const int w,
+                                           const int h,
+                                           const ScalingFilter filter)
+{
+    if (w <= 0 || h <= 0)
+        return {};
+
+    if (filter == ScalingFilter::GDK_BILINEAR)
+        return pixbuf->scale_simple(w, h, Gdk::INTERP_BILINEAR);
+
+    return scale_region(pixbuf, w, h, 0, 0, w, h, filter);
+}
+
+Glib::RefPtr<Gdk::Pixbuf> Resampler::scale_region(const Glib::RefPtr<Gdk::Pixbuf>& pixbuf,
+                                                  const int full_w,
+                                                  const int full_h,
+                                                  const int x,
+                                                  const int y,
+                                                  const int w,
+                                                  const int h,
+                                                  const ScalingFilter filter)
+{
+    if (w <= 0 || h <= 0 || full_w <= 0 || full_h <= 0)
+        return {};
+
+    auto dst{ Gdk::Pixbuf::create(Gdk::COLORSPACE_RGB, pixbuf->get_has_alpha(), 8, w, h) };
+    if (!dst)
+        return {};
+
+    if (filter == ScalingFilter::GDK_BILINEAR || pixbuf->get_bits_per_sample() != 8 ||
+        pixbuf->get_n_channels() != (pixbuf->get_has_alpha() ? 4 : 3))
+    {
+        pixbuf->scale(dst,
+                      0,
+                      0,
+                      w,
+                      h,
+                      -x,
+                      -y,
+                      static_cast<double>(full_w) / pixbuf->get_width(),
+                      static_cast<double>(full_h) / pixbuf->get_height(),
+                      Gdk::INTERP_BILINEAR);
+        return dst;
+    }
+
+    scale_pixels(pixbuf->get_pixels(),
+                 pixbuf->get_width(),
+                 pixbuf->get_height(),
+                 pixbuf->get_rowstride(),
+                 dst->get_pixels(),
+                 dst->get_rowstride(),
+                 pixbuf->get_n_channels(),
+                 full_w,
+                 full_h,
+                 x,
+                 y,
+                 w,
+                 h,
+                 filter);
+
+    return dst;
+}
+
+const char* Resampler::get_simd_name()
+{
+    return get_ops().name;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "util.h"
+
+#include <cstdint>
+#include <gdkmm.h>
+
+namespace AhoViewer
+{
+    // A separable resampler for 8 bit RGB and RGBA pixbufs.  Rows are split between
+    // threads, and the filtering uses AVX2 or SSE2 when the CPU supports them
+    namespace Resampler
+    {
+        // Returns pixbuf scaled to w x h, or nullptr if either is 0
+        Glib::RefPtr<Gdk::Pixbuf> scale(const Glib::RefPtr<Gdk::Pixbuf>& pixbuf,
+                                        const int w,
+                                        const int h,
+                                        const ScalingFilter filter);
+
+        // Returns the w x h region at x, y of pixbuf scaled to full_w x full_h, or nullptr
+        // if the region is empty or the pixbuf couldn't be allocated
+        Glib::RefPtr<Gdk::Pixbuf> scale_region(const Glib::RefPtr<Gdk::Pixbuf>& pixbuf,
+                                               const int full_w,
+                                               const int full_h,
+                                               const int x,
+                                               const int y,
+                                               const int w,
+                                               const int h,
+                                               const ScalingFilter filter);
+
+        // Does the actual work of the above on raw pixel data, channels must be 3 or 4.
+        // Passing 0 for n_threads picks the number of threads based on the size of the region
+        void scale_pixels(const uint8_t* src,
+                          const int src_w,
+                          const int src_h,
+                          const int src_stride,
+                          uint8_t* dst,
+                          const int dst_stride,
+                          const int channels,
+                          const int full_w,
+                          const int full_h,
+                          const int x,
+                          const int y,
+                          const int w,
+                          const int h,
+                          const ScalingFilter filter,
+                          unsigned int n_threads = 0);
+
+        // Name of the instruction set being used, for the benchmark
+        const char* get_simd_name();
+    }
+}
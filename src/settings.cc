@@ -30,9 +30,12 @@ SettingsManager::SettingsManager()
           { "HideAll", false },           { "HideAllFullscreen", true },
           { "RememberWindowSize", true }, { "RememberWindowPos", true },
           { "ShowTagTypeHeaders", true }, { "AutoHideInfoBox", true },
+          { "DecodeAtFitSize", true },    { "ThumbnailDatabase", true },
       }),
       m_DefaultInts({ { "ArchiveIndex", -1 },
                       { "CacheSize", 2 },
+                      { "CacheMemory", 512 },
+                      { "GIFFrameMemory", 64 },
                       { "SlideshowDelay", 5 },
                       { "CursorHideDelay", 2 },
                       { "TagViewPosition", 520 },
@@ -406,6 +409,25 @@ void SettingsManager::set_zoom_mode(const ZoomMode value)
     set("ZoomMode", std::string(1, static_cast<char>(value)));
 }
 
+ScalingFilter SettingsManager::get_scaling_filter() const
+{
+    if (m_Config.exists("ScalingFilter"))
+    {
+        const int value{ static_cast<int>(m_Config.lookup("ScalingFilter")) };
+        // Hand edited config files may have a filter that doesn't exist
+        if (value >= static_cast<int>(ScalingFilter::GDK_BILINEAR) &&
+            value <= static_cast<int>(ScalingFilter::AREA))
+            return ScalingFilter(value);
+    }
+
+    return m_DefaultScalingFilter;
+}
+
+void SettingsManager::set_scaling_filter(const ScalingFilter value)
+{
+    set("ScalingFilter", static_cast<int>(value));
+}
+
 Booru::TagViewOrder SettingsManager::get_tag_view_order() const
 {
     if (m_Config.exists("TagViewOrder"))
@@ -63,6 +63,9 @@ namespace AhoViewer
         ZoomMode get_zoom_mode() const;
         void set_zoom_mode(const ZoomMode value);
 
+        ScalingFilter get_scaling_filter() const;
+        void set_scaling_filter(const ScalingFilter value);
+
         Booru::TagViewOrder get_tag_view_order() const;
         void set_tag_view_order(const Booru::TagViewOrder value);
 
@@ -97,6 +100,8 @@ namespace AhoViewer
         const std::map<std::string, std::map<std::string, std::string>> m_DefaultKeybindings;
         const Booru::Rating m_DefaultBooruMaxRating{ Booru::Rating::EXPLICIT };
         const ZoomMode m_DefaultZoomMode{ ZoomMode::MANUAL };
+        // GdkPixbuf stays the default until the resampler is benchmarked against it
+        const ScalingFilter m_DefaultScalingFilter{ ScalingFilter::GDK_BILINEAR };
         const Booru::TagViewOrder m_DefaultTagViewOrder{ Booru::TagViewOrder::TYPE };
 
         std::vector<std::shared_ptr<Booru::Site>> m_Sites;
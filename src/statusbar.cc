@@ -83,6 +83,20 @@ void StatusBar::set_progress(const std::string& msg,
             delay);
 }
 
+// Pulses the progress bar each time it's called
+void StatusBar::pulse_progress(const std::string& msg, const Priority priority)
+{
+    if (priority < m_ProgressPriority)
+        return;
+
+    set_message(msg, priority, 0);
+
+    m_ProgressConn.disconnect();
+    m_ProgressPriority = priority;
+    m_ProgressBar->pulse();
+    m_ProgressBar->show();
+}
+
 void StatusBar::clear_page_info()
 {
     m_PageInfo->set_text("");
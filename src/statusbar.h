@@ -30,6 +30,8 @@ namespace AhoViewer
                           const double prog,
                           const Priority priority  = Priority::MESSAGE,
                           const std::uint8_t delay = 3);
+        // For progress without a known total, the message stays until it is cleared
+        void pulse_progress(const std::string& msg, const Priority priority = Priority::MESSAGE);
 
         void clear_page_info();
         void clear_resolution();
@@ -132,6 +132,9 @@ namespace AhoViewer
             init();
         }
 
+        // Removes remaining tasks without waiting for the running ones to finish
+        void clear_queue() { m_Queue.clear(); }
+
         // Waits for remaining tasks to complete and resets the pool back to it's initial state
         void wait()
         {
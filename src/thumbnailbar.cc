@@ -13,7 +13,7 @@ ThumbnailBar::ThumbnailBar(BaseObjectType* cobj, const Glib::RefPtr<Gtk::Builder
     m_VAdjust =
         Glib::RefPtr<Gtk::Adjustment>::cast_static(bldr->get_object("ThumbnailBar::VAdjust"));
 
-    m_TreeView->set_model(m_ListStore);
+    m_TreeView->set_model(m_Model);
     m_TreeView->append_column("Thumbnail", m_Columns.pixbuf);
     m_TreeView->set_size_request(Image::ThumbnailSize + 9, -1);
     m_CursorConn = m_TreeView->signal_cursor_changed().connect(
@@ -23,25 +23,47 @@ ThumbnailBar::ThumbnailBar(BaseObjectType* cobj, const Glib::RefPtr<Gtk::Builder
     // called when thumbnails are being loaded
     m_ScrollConn =
         get_vadjustment()->signal_value_changed().connect([&]() { m_KeepAligned = false; });
+
+    // Thumbnails in view are loaded first
+    get_vadjustment()->signal_value_changed().connect([&]() { m_SignalVisibleRangeChanged(); });
+    get_vadjustment()->signal_changed().connect([&]() { m_SignalVisibleRangeChanged(); });
+    signal_map().connect([&]() { m_SignalVisibleRangeChanged(); });
+    signal_unmap().connect([&]() { m_SignalVisibleRangeChanged(); });
+}
+
+ThumbnailBar::~ThumbnailBar()
+{
+    m_AlignConn.disconnect();
 }
 
 void ThumbnailBar::clear()
 {
     ImageList::Widget::clear();
+    m_AlignConn.disconnect();
     m_KeepAligned = true;
 }
 
-void ThumbnailBar::set_pixbuf(const size_t index, const Glib::RefPtr<Gdk::Pixbuf>& pixbuf)
+void ThumbnailBar::set_pixbufs(const PixbufVector& pixbufs)
 {
     m_ScrollConn.block();
-    ImageList::Widget::set_pixbuf(index, pixbuf);
-    while (Glib::MainContext::get_default()->pending())
-        Glib::MainContext::get_default()->iteration(true);
+    ImageList::Widget::set_pixbufs(pixbufs);
     m_ScrollConn.unblock();
 
-    // Keep the selected image centered while thumbnails are being added
-    if (m_KeepAligned)
-        scroll_to_selected();
+    // Keep the selected image centered while thumbnails are being added.  This is done
+    // once per batch after the frame that lays out the new rows
+    if (m_KeepAligned && !m_AlignConn)
+        queue_center_selected();
+}
+
+// Idle handlers run after the tree view has validated and laid out its rows, so the
+// selected row's position is up to date by then
+void ThumbnailBar::queue_center_selected()
+{
+    m_AlignConn.disconnect();
+    m_AlignConn = Glib::signal_idle().connect([&]() {
+        center_selected();
+        return false;
+    });
 }
 
 void ThumbnailBar::on_show()
@@ -58,6 +80,11 @@ void ThumbnailBar::set_selected(const size_t index)
 }
 
 void ThumbnailBar::scroll_to_selected()
+{
+    queue_center_selected();
+}
+
+void ThumbnailBar::center_selected()
 {
     if (get_window())
     {
@@ -67,10 +94,6 @@ void ThumbnailBar::scroll_to_selected()
         Gtk::TreeViewColumn* column = m_TreeView->get_column(0);
         Gdk::Rectangle rect;
 
-        // Make sure everything is updated before getting scroll position
-        while (Glib::MainContext::get_default()->pending())
-            Glib::MainContext::get_default()->iteration(true);
-
         // Center the selected thumbnail
         m_TreeView->get_background_area(path, *column, rect);
         double value = m_VAdjust->get_value() + rect.get_y() + (rect.get_height() / 2) -
@@ -86,6 +109,18 @@ void ThumbnailBar::scroll_to_selected()
     }
 }
 
+bool ThumbnailBar::get_visible_range(size_t& first, size_t& last) const
+{
+    Gtk::TreePath start, end;
+    if (!get_mapped() || !m_TreeView->get_visible_range(start, end))
+        return false;
+
+    first = start[0];
+    last  = end[0];
+
+    return true;
+}
+
 void ThumbnailBar::on_cursor_changed()
 {
     Gtk::TreePath path;
@@ -94,7 +129,5 @@ void ThumbnailBar::on_cursor_changed()
     m_TreeView->get_cursor(path, column);
     m_SignalSelectedChanged(path[0]);
 
-    Gtk::TreeIter iter = m_ListStore->get_iter(path);
-    if (iter)
-        m_KeepAligned = !iter->get_value(m_Columns.pixbuf);
+    m_KeepAligned = !get_pixbuf(path[0]);
 }
@@ -10,23 +10,28 @@ namespace AhoViewer
     {
     public:
         ThumbnailBar(BaseObjectType*, const Glib::RefPtr<Gtk::Builder>&);
-        ~ThumbnailBar() override = default;
+        ~ThumbnailBar() override;
 
         void clear() override;
-        void set_pixbuf(const size_t index, const Glib::RefPtr<Gdk::Pixbuf>& pixbuf) override;
+        void set_pixbufs(const PixbufVector& pixbufs) override;
 
     protected:
         void on_show() override;
 
         void set_selected(const size_t index) override;
         void scroll_to_selected() override;
+        bool get_visible_range(size_t& first, size_t& last) const override;
+        void detach_model() override { m_TreeView->unset_model(); }
+        void attach_model() override { m_TreeView->set_model(m_Model); }
 
     private:
+        void queue_center_selected();
+        void center_selected();
         void on_cursor_changed();
 
         Gtk::TreeView* m_TreeView;
         Glib::RefPtr<Gtk::Adjustment> m_VAdjust;
         bool m_KeepAligned{ true };
-        sigc::connection m_ScrollConn;
+        sigc::connection m_ScrollConn, m_AlignConn;
     };
 }
@@ -0,0 +1,184 @@
+#include "thumbnailmodel.h"
+using namespace AhoViewer;
+
+using PixbufValue = Glib::Value<Glib::RefPtr<Gdk::Pixbuf>>;
+
+ThumbnailModel::ThumbnailModel() : Glib::ObjectBase{ typeid(ThumbnailModel) }, Glib::Object{} { }
+
+void ThumbnailModel::append(const size_t n)
+{
+    const size_t old_size{ m_Size };
+    m_Size += n;
+
+    for (size_t i = old_size; i < m_Size; ++i)
+    {
+        iterator iter;
+        make_iter(i, iter);
+        row_inserted(Path(1, i), iter);
+    }
+}
+
+void ThumbnailModel::insert(const size_t index)
+{
+    const size_t i{ std::min(index, m_Size) };
+    ++m_Size;
+    ++m_Stamp;
+
+    iterator iter;
+    make_iter(i, iter);
+    row_inserted(Path(1, i), iter);
+}
+
+void ThumbnailModel::erase(const size_t index)
+{
+    if (index >= m_Size)
+        return;
+
+    --m_Size;
+    ++m_Stamp;
+
+    row_deleted(Path(1, index));
+}
+
+void ThumbnailModel::clear()
+{
+    // Deleting from the end doesn't shift the remaining rows
+    while (m_Size > 0)
+        row_deleted(Path(1, --m_Size));
+
+    ++m_Stamp;
+}
+
+// The image list may have already changed its vector when rows are being inserted or
+// erased, so indices past the end of it are treated as rows without a thumbnail
+Glib::RefPtr<Gdk::Pixbuf> ThumbnailModel::get_pixbuf(const size_t index) const
+{
+    if (!m_Images || index >= m_Size || index >= m_Images->size())
+        return {};
+
+    return (*m_Images)[index]->get_widget_thumbnail();
+}
+
+void ThumbnailModel::set_pixbuf(const size_t index, const Glib::RefPtr<Gdk::Pixbuf>& pixbuf)
+{
+    if (!m_Images || index >= m_Size || index >= m_Images->size())
+        return;
+
+    (*m_Images)[index]->set_widget_thumbnail(pixbuf);
+
+    iterator iter;
+    make_iter(index, iter);
+    row_changed(Path(1, index), iter);
+}
+
+Gtk::TreeModelFlags ThumbnailModel::get_flags_vfunc() const
+{
+    return Gtk::TREE_MODEL_LIST_ONLY;
+}
+
+int ThumbnailModel::get_n_columns_vfunc() const
+{
+    return 1;
+}
+
+GType ThumbnailModel::get_column_type_vfunc(int) const
+{
+    return PixbufValue::value_type();
+}
+
+void ThumbnailModel::get_value_vfunc(const iterator& iter, int, Glib::ValueBase& value) const
+{
+    PixbufValue pixbuf_value;
+    pixbuf_value.init(PixbufValue::value_type());
+
+    size_t index;
+    if (get_index(iter, index))
+        pixbuf_value.set(get_pixbuf(index));
+
+    value.init(PixbufValue::value_type());
+    value = pixbuf_value;
+}
+
+bool ThumbnailModel::iter_next_vfunc(const iterator& iter, iterator& iter_next) const
+{
+    size_t index;
+    return get_index(iter, index) && make_iter(index + 1, iter_next);
+}
+
+bool ThumbnailModel::iter_children_vfunc(const iterator&, iterator& iter) const
+{
+    iter = iterator();
+    return false;
+}
+
+bool ThumbnailModel::iter_has_child_vfunc(const iterator&) const
+{
+    return false;
+}
+
+int ThumbnailModel::iter_n_children_vfunc(const iterator&) const
+{
+    return 0;
+}
+
+int ThumbnailModel::iter_n_root_children_vfunc() const
+{
+    return m_Size;
+}
+
+bool ThumbnailModel::iter_nth_child_vfunc(const iterator&, int, iterator& iter) const
+{
+    iter = iterator();
+    return false;
+}
+
+bool ThumbnailModel::iter_nth_root_child_vfunc(int n, iterator& iter) const
+{
+    return n >= 0 && make_iter(n, iter);
+}
+
+bool ThumbnailModel::iter_parent_vfunc(const iterator&, iterator& iter) const
+{
+    iter = iterator();
+    return false;
+}
+
+Gtk::TreeModel::Path ThumbnailModel::get_path_vfunc(const iterator& iter) const
+{
+    size_t index;
+    return get_index(iter, index) ? Path(1, index) : Path();
+}
+
+bool ThumbnailModel::get_iter_vfunc(const Path& path, iterator& iter) const
+{
+    if (path.size() != 1 || path[0] < 0)
+    {
+        iter = iterator();
+        return false;
+    }
+
+    return make_iter(path[0], iter);
+}
+
+bool ThumbnailModel::make_iter(const size_t index, iterator& iter) const
+{
+    if (index >= m_Size)
+    {
+        iter = iterator();
+        return false;
+    }
+
+    iter.set_stamp(m_Stamp);
+    iter.gobj()->user_data = GSIZE_TO_POINTER(index);
+
+    return true;
+}
+
+bool ThumbnailModel::get_index(const iterator& iter, size_t& index) const
+{
+    if (iter.get_stamp() != m_Stamp)
+        return false;
+
+    index = GPOINTER_TO_SIZE(iter.gobj()->user_data);
+    return index < m_Size;
+}
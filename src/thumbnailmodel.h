@@ -0,0 +1,73 @@
+#pragma once
+
+#include "image.h"
+
+#include <gtkmm.h>
+#include <memory>
+#include <vector>
+
+namespace AhoViewer
+{
+    // A flat list model with a single pixbuf column, used by ImageList::Widget.
+    // Each row is the image at the same index of the image list's vector, the model only
+    // keeps the number of rows and reads the thumbnails from the images when the view
+    // asks for them.  Rows are addressed by index and iters store the index directly, so
+    // there are no string paths or per row allocations.
+    // The row count is only changed by append, insert, erase and clear, the image list
+    // calls them as it changes its vector so the view is told about every row
+    class ThumbnailModel : public Glib::Object, public Gtk::TreeModel
+    {
+    public:
+        using ImageVector = std::vector<std::shared_ptr<Image>>;
+
+        static Glib::RefPtr<ThumbnailModel> create()
+        {
+            return Glib::RefPtr<ThumbnailModel>(new ThumbnailModel());
+        }
+
+        // images must outlive the model or be unset by passing nullptr
+        void set_images(const ImageVector* images) { m_Images = images; }
+
+        size_t size() const { return m_Size; }
+        // Adds n rows to the end
+        void append(const size_t n);
+        void insert(const size_t index);
+        void erase(const size_t index);
+        void clear();
+
+        // Returns a null pixbuf for rows whose thumbnail hasn't been set
+        Glib::RefPtr<Gdk::Pixbuf> get_pixbuf(const size_t index) const;
+        void set_pixbuf(const size_t index, const Glib::RefPtr<Gdk::Pixbuf>& pixbuf);
+
+    protected:
+        ThumbnailModel();
+
+        Gtk::TreeModelFlags get_flags_vfunc() const override;
+        int get_n_columns_vfunc() const override;
+        GType get_column_type_vfunc(int index) const override;
+        void get_value_vfunc(const iterator& iter,
+                             int column,
+                             Glib::ValueBase& value) const override;
+
+        bool iter_next_vfunc(const iterator& iter, iterator& iter_next) const override;
+        bool iter_children_vfunc(const iterator& parent, iterator& iter) const override;
+        bool iter_has_child_vfunc(const iterator& iter) const override;
+        int iter_n_children_vfunc(const iterator& iter) const override;
+        int iter_n_root_children_vfunc() const override;
+        bool iter_nth_child_vfunc(const iterator& parent, int n, iterator& iter) const override;
+        bool iter_nth_root_child_vfunc(int n, iterator& iter) const override;
+        bool iter_parent_vfunc(const iterator& child, iterator& iter) const override;
+        Path get_path_vfunc(const iterator& iter) const override;
+        bool get_iter_vfunc(const Path& path, iterator& iter) const override;
+
+    private:
+        // Returns false and leaves iter invalid if index is out of range
+        bool make_iter(const size_t index, iterator& iter) const;
+        bool get_index(const iterator& iter, size_t& index) const;
+
+        const ImageVector* m_Images{ nullptr };
+        size_t m_Size{ 0 };
+        // Changed whenever rows are inserted or removed, which invalidates iters
+        int m_Stamp{ 1 };
+    };
+}
@@ -0,0 +1,279 @@
+#include "thumbnailstore.h"
+using namespace AhoViewer;
+
+#include "config.h"
+
+#include <cstring>
+#include <glib/gstdio.h>
+#include <iostream>
+
+ThumbnailStore::ThumbnailStore()
+{
+    std::string dir{ Glib::build_filename(Glib::get_user_cache_dir(), PACKAGE) };
+    g_mkdir_with_parents(dir.c_str(), 0700);
+
+    m_IndexPath = Glib::build_filename(dir, "thumbnails.index");
+    m_PackPath  = Glib::build_filename(dir, "thumbnails.pack");
+
+    GStatBuf file_info;
+    if (g_stat(m_PackPath.c_str(), &file_info) == 0 && file_info.st_size >= RotatePackSize)
+    {
+        g_unlink(m_IndexPath.c_str());
+        g_unlink(m_PackPath.c_str());
+    }
+
+    m_PackStream.open(m_PackPath, std::ios::binary | std::ios::app);
+    if (!m_PackStream)
+        std::cerr << "Failed to open thumbnail database '" << m_PackPath << "'" << std::endl;
+
+    map_index();
+}
+
+ThumbnailStore::~ThumbnailStore()
+{
+    std::scoped_lock lock{ m_Mutex };
+    if (!m_Pending.empty())
+        write_index();
+}
+
+Glib::RefPtr<Gdk::Pixbuf>
+ThumbnailStore::lookup(const std::string& key, const int64_t mtime, const int64_t size)
+{
+    const uint64_t h{ hash(key) };
+    IndexEntry entry;
+    std::shared_ptr<ImageData> pack;
+
+    {
+        std::scoped_lock lock{ m_Mutex };
+        auto it{ m_Pending.find(h) };
+        if (it != m_Pending.end())
+            entry = it->second;
+        else if (!find(h, entry))
+            return {};
+
+        if (entry.mtime != mtime || entry.size != size)
+            return {};
+
+        // The record was appended after the pack was mapped
+        if (!m_Pack || entry.offset + sizeof(RecordHeader) > m_Pack->get_size())
+        {
+            try
+            {
+                m_Pack = ImageData::create_from_file(m_PackPath);
+            }
+            catch (const Glib::FileError&)
+            {
+                return {};
+            }
+        }
+
+        pack = m_Pack;
+    }
+
+    // Make sure the record is the one that was looked up, the index can be out of date
+    // if another instance of ahoviewer appended to the pack
+    RecordHeader header;
+    if (entry.offset + sizeof(header) > pack->get_size())
+        return {};
+
+    const unsigned char* record{ pack->get_data() + entry.offset };
+    std::memcpy(&header, record, sizeof(header));
+    record += sizeof(header);
+
+    if (header.magic != RecordMagic || header.mtime != mtime || header.size != size ||
+        header.key_size != key.size() ||
+        entry.offset + sizeof(header) + header.key_size + header.data_size > pack->get_size() ||
+        key.compare(0, key.size(), reinterpret_cast<const char*>(record), header.key_size) != 0)
+        return {};
+
+    try
+    {
+        auto loader{ Gdk::PixbufLoader::create("png") };
+        loader->write(record + header.key_size, header.data_size);
+        loader->close();
+
+        return loader->get_pixbuf();
+    }
+    catch (const Glib::Error& ex)
+    {
+        std::cerr << "Failed to load thumbnail for '" << key << "' from the thumbnail database"
+                  << std::endl
+                  << "  " << ex.what() << std::endl;
+    }
+
+    return {};
+}
+
+void ThumbnailStore::add(const std::string& key,
+                         const int64_t mtime,
+                         const int64_t size,
+                         const Glib::RefPtr<Gdk::Pixbuf>& pixbuf)
+{
+    gchar* buf;
+    gsize buf_size;
+    try
+    {
+        pixbuf->save_to_buffer(buf, buf_size, "png");
+    }
+    catch (const Glib::Error& ex)
+    {
+        std::cerr << "Failed to save thumbnail for '" << key << "'" << std::endl
+                  << "  " << ex.what() << std::endl;
+        return;
+    }
+
+    RecordHeader header{
+        RecordMagic, static_cast<uint32_t>(key.size()), static_cast<uint32_t>(buf_size), 0,
+        mtime,       size,
+    };
+
+    std::string record;
+    record.reserve(sizeof(header) + key.size() + buf_size);
+    record.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    record.append(key);
+    record.append(buf, buf_size);
+    g_free(buf);
+
+    std::scoped_lock lock{ m_Mutex };
+    GStatBuf file_info;
+    if (!m_PackStream || g_stat(m_PackPath.c_str(), &file_info) != 0 ||
+        file_info.st_size + static_cast<int64_t>(record.size()) > MaxPackSize)
+        return;
+
+    // Written with one call so records appended by other instances don't interleave
+    m_PackStream.write(record.data(), record.size());
+    m_PackStream.flush();
+
+    if (!m_PackStream)
+    {
+        std::cerr << "Failed to write to thumbnail database '" << m_PackPath << "'"
+                  << std::endl;
+        return;
+    }
+
+    const uint64_t h{ hash(key) };
+    m_Pending[h] = { h, mtime, size, static_cast<uint64_t>(file_info.st_size) };
+
+    if (m_Pending.size() >= FlushThreshold)
+        write_index();
+}
+
+// FNV-1a, 0 is used for empty index slots
+uint64_t ThumbnailStore::hash(const std::string& key)
+{
+    uint64_t h{ 0xcbf29ce484222325 };
+    for (const unsigned char c : key)
+        h = (h ^ c) * 0x100000001b3;
+
+    return h ? h : 1;
+}
+
+void ThumbnailStore::map_index()
+{
+    m_Index.reset();
+
+    try
+    {
+        m_Index = ImageData::create_from_file(m_IndexPath);
+    }
+    catch (const Glib::FileError&)
+    {
+        return;
+    }
+
+    IndexHeader header;
+    if (m_Index->get_size() >= sizeof(header))
+        std::memcpy(&header, m_Index->get_data(), sizeof(header));
+
+    // Capacity has to be a power of 2 for find
+    if (m_Index->get_size() < sizeof(header) ||
+        std::memcmp(header.magic, IndexMagic, sizeof(IndexMagic)) != 0 ||
+        header.version != Version || header.capacity == 0 ||
+        (header.capacity & (header.capacity - 1)) != 0 ||
+        m_Index->get_size() < sizeof(header) + header.capacity * sizeof(IndexEntry))
+    {
+        m_Index.reset();
+    }
+}
+
+bool ThumbnailStore::find(const uint64_t hash, IndexEntry& entry) const
+{
+    if (!m_Index)
+        return false;
+
+    const auto* header{ reinterpret_cast<const IndexHeader*>(m_Index->get_data()) };
+    const auto* entries{ reinterpret_cast<const IndexEntry*>(header + 1) };
+    const uint32_t mask{ header->capacity - 1 };
+
+    for (uint32_t i = hash & mask, n = 0; n < header->capacity; i = (i + 1) & mask, ++n)
+    {
+        if (entries[i].hash == 0)
+            break;
+
+        if (entries[i].hash == hash)
+        {
+            entry = entries[i];
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Rewrites the index with the pending entries added to it, m_Mutex must be held
+void ThumbnailStore::write_index()
+{
+    // Map it again in case another instance has written it since it was mapped
+    map_index();
+
+    std::vector<IndexEntry> entries;
+    if (m_Index)
+    {
+        const auto* header{ reinterpret_cast<const IndexHeader*>(m_Index->get_data()) };
+        const auto* mapped{ reinterpret_cast<const IndexEntry*>(header + 1) };
+
+        entries.reserve(header->count + m_Pending.size());
+        for (uint32_t i = 0; i < header->capacity; ++i)
+            if (mapped[i].hash != 0 && m_Pending.find(mapped[i].hash) == m_Pending.end())
+                entries.push_back(mapped[i]);
+    }
+
+    for (const auto& [h, entry] : m_Pending)
+        entries.push_back(entry);
+
+    // Keep the table at most half full so probes stay short
+    uint32_t capacity{ 1024 };
+    while (capacity < entries.size() * 2)
+        capacity *= 2;
+
+    std::string buf(sizeof(IndexHeader) + capacity * sizeof(IndexEntry), '\0');
+    IndexHeader header{ {}, Version, capacity, entries.size() };
+    std::memcpy(header.magic, IndexMagic, sizeof(IndexMagic));
+    std::memcpy(buf.data(), &header, sizeof(header));
+
+    auto* table{ reinterpret_cast<IndexEntry*>(buf.data() + sizeof(header)) };
+    for (const IndexEntry& entry : entries)
+    {
+        uint32_t i = entry.hash & (capacity - 1);
+        while (table[i].hash != 0)
+            i = (i + 1) & (capacity - 1);
+        table[i] = entry;
+    }
+
+    // Windows can't replace a file that is mapped
+    m_Index.reset();
+
+    try
+    {
+        Glib::file_set_contents(m_IndexPath, buf.data(), buf.size());
+        m_Pending.clear();
+    }
+    catch (const Glib::FileError& ex)
+    {
+        std::cerr << "Failed to write thumbnail database index '" << m_IndexPath << "'"
+                  << std::endl
+                  << "  " << ex.what() << std::endl;
+    }
+
+    map_index();
+}
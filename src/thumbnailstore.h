@@ -0,0 +1,84 @@
+#pragma once
+
+#include "imagedata.h"
+
+#include <cstdint>
+#include <fstream>
+#include <gdkmm.h>
+#include <mutex>
+#include <unordered_map>
+
+namespace AhoViewer
+{
+    // ahoviewer's own thumbnail database, used before the freedesktop thumbnail
+    // directory.  Thumbnails are appended as PNGs to a single pack file and an open
+    // addressing hash table, keyed by the hash of the path, maps them to their offset
+    // in the pack.  Both files are memory mapped so a lookup doesn't open any files.
+    // Thumbnails added while running are kept in m_Pending until the index is
+    // rewritten with them
+    class ThumbnailStore
+    {
+    public:
+        static ThumbnailStore& get_instance()
+        {
+            static ThumbnailStore i;
+            return i;
+        }
+
+        // mtime and size are those of the file the thumbnail was made from, the
+        // thumbnail is only returned if they still match
+        Glib::RefPtr<Gdk::Pixbuf>
+        lookup(const std::string& key, const int64_t mtime, const int64_t size);
+        void add(const std::string& key,
+                 const int64_t mtime,
+                 const int64_t size,
+                 const Glib::RefPtr<Gdk::Pixbuf>& pixbuf);
+
+    private:
+        struct IndexHeader
+        {
+            char magic[8];
+            uint32_t version, capacity;
+            uint64_t count;
+        };
+        // hash is 0 for empty slots
+        struct IndexEntry
+        {
+            uint64_t hash;
+            int64_t mtime, size;
+            uint64_t offset;
+        };
+        // Followed by the key and the PNG data
+        struct RecordHeader
+        {
+            uint32_t magic, key_size, data_size, reserved;
+            int64_t mtime, size;
+        };
+
+        ThumbnailStore();
+        ~ThumbnailStore();
+
+        static uint64_t hash(const std::string& key);
+
+        void map_index();
+        bool find(const uint64_t hash, IndexEntry& entry) const;
+        void write_index();
+
+        static constexpr char IndexMagic[8]{ 'A', 'H', 'O', 'T', 'H', 'U', 'M', 'B' };
+        static constexpr uint32_t RecordMagic{ 0x42485441 }, Version{ 1 };
+        // The pack is only appended to and add stops once it would grow past MaxPackSize.
+        // It is started over the next time ahoviewer is opened once it has reached
+        // RotatePackSize, a thumbnail record is far smaller than the difference so a pack
+        // that add has refused a record for is always rotated
+        static constexpr int64_t MaxPackSize{ 512 << 20 },
+            RotatePackSize{ MaxPackSize - (1 << 20) };
+        // Number of pending thumbnails before the index is rewritten
+        static constexpr size_t FlushThreshold{ 256 };
+
+        std::string m_IndexPath, m_PackPath;
+        std::shared_ptr<ImageData> m_Index, m_Pack;
+        std::unordered_map<uint64_t, IndexEntry> m_Pending;
+        std::ofstream m_PackStream;
+        std::mutex m_Mutex;
+    };
+}
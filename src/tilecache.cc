@@ -0,0 +1,200 @@
+#include "tilecache.h"
+using namespace AhoViewer;
+
+#include "resampler.h"
+
+#include <cmath>
+
+TileCache::TileCache() : m_ThreadPool{ std::max(std::thread::hardware_concurrency() / 2, 1u) }
+{
+    m_SignalTileLoaded.connect(sigc::mem_fun(*this, &TileCache::on_tile_loaded));
+}
+
+TileCache::~TileCache()
+{
+    clear();
+    // Running tasks still emit m_SignalTileLoaded
+    m_ThreadPool.kill();
+}
+
+void TileCache::set_source(const Glib::RefPtr<Gdk::Pixbuf>& pixbuf,
+                           const int w,
+                           const int h,
+                           const ScalingFilter filter)
+{
+    if (pixbuf == m_Pixbuf && w == m_Width && h == m_Height && filter == m_Filter)
+        return;
+
+    clear();
+
+    m_Pixbuf = pixbuf;
+    m_Width  = w;
+    m_Height = h;
+    m_Filter = filter;
+}
+
+// Tiles that are already being scaled are not waited for, they have their own reference
+// to the source and are dropped by on_tile_loaded
+void TileCache::clear()
+{
+    ++m_Generation;
+    m_ThreadPool.clear_queue();
+
+    m_Pixbuf.reset();
+    m_Width = m_Height = 0;
+
+    m_Tiles.clear();
+    m_Pending.clear();
+    m_LoadedQueue.clear();
+}
+
+void TileCache::draw(const Cairo::RefPtr<Cairo::Context>& cr, const Gdk::Rectangle& viewport)
+{
+    if (!m_Pixbuf)
+        return;
+
+    double x1, y1, x2, y2;
+    cr->get_clip_extents(x1, y1, x2, y2);
+
+    const int cols{ (m_Width + TileSize - 1) / TileSize },
+        rows{ (m_Height + TileSize - 1) / TileSize };
+    const int c0{ std::max(static_cast<int>(x1) / TileSize, 0) },
+        r0{ std::max(static_cast<int>(y1) / TileSize, 0) },
+        c1{ std::min(static_cast<int>(std::ceil(x2)) / TileSize, cols - 1) },
+        r1{ std::min(static_cast<int>(std::ceil(y2)) / TileSize, rows - 1) };
+
+    // GTK may only redraw the part of the widget that was scrolled into view,
+    // so the tiles to keep are based on the viewport as well as the clip region
+    {
+        std::scoped_lock lock{ m_VisibleMutex };
+        m_VisibleStart = { std::min(c0, viewport.get_x() / TileSize) - 1,
+                           std::min(r0, viewport.get_y() / TileSize) - 1 };
+        m_VisibleEnd   = {
+            std::max(c1, (viewport.get_x() + viewport.get_width()) / TileSize) + 1,
+            std::max(r1, (viewport.get_y() + viewport.get_height()) / TileSize) + 1
+        };
+    }
+
+    // Evict the tiles that have scrolled out of view
+    for (auto it = m_Tiles.begin(); it != m_Tiles.end();)
+    {
+        if (is_visible(it->first))
+            ++it;
+        else
+            it = m_Tiles.erase(it);
+    }
+
+    for (int r = r0; r <= r1; ++r)
+    {
+        for (int c = c0; c <= c1; ++c)
+        {
+            const TileKey key{ c, r };
+            Glib::RefPtr<Gdk::Pixbuf> tile;
+            auto it{ m_Tiles.find(key) };
+
+            if (it != m_Tiles.end())
+            {
+                tile = it->second;
+            }
+            else
+            {
+                queue_tile(key);
+                // Nearest neighbour is cheap enough to do here for a single tile
+                tile = create_fast_tile(key);
+            }
+
+            Gdk::Cairo::set_source_pixbuf(cr, tile, c * TileSize, r * TileSize);
+            cr->rectangle(c * TileSize, r * TileSize, tile->get_width(), tile->get_height());
+            cr->fill();
+        }
+    }
+}
+
+Glib::RefPtr<Gdk::Pixbuf> TileCache::create_fast_tile(const TileKey& key) const
+{
+    const int x{ key.first * TileSize }, y{ key.second * TileSize },
+        w{ std::min(TileSize, m_Width - x) }, h{ std::min(TileSize, m_Height - y) };
+
+    auto tile{ Gdk::Pixbuf::create(Gdk::COLORSPACE_RGB, m_Pixbuf->get_has_alpha(), 8, w, h) };
+    m_Pixbuf->scale(tile,
+                    0,
+                    0,
+                    w,
+                    h,
+                    -x,
+                    -y,
+                    static_cast<double>(m_Width) / m_Pixbuf->get_width(),
+                    static_cast<double>(m_Height) / m_Pixbuf->get_height(),
+                    Gdk::INTERP_NEAREST);
+
+    return tile;
+}
+
+Glib::RefPtr<Gdk::Pixbuf> TileCache::create_tile(const TileKey& key,
+                                                 const Glib::RefPtr<Gdk::Pixbuf>& pixbuf,
+                                                 const int width,
+                                                 const int height,
+                                                 const ScalingFilter filter)
+{
+    const int x{ key.first * TileSize }, y{ key.second * TileSize },
+        w{ std::min(TileSize, width - x) }, h{ std::min(TileSize, height - y) };
+
+    return Resampler::scale_region(pixbuf, width, height, x, y, w, h, filter);
+}
+
+void TileCache::queue_tile(const TileKey& key)
+{
+    if (!m_Pending.insert(key).second)
+        return;
+
+    m_ThreadPool.push([&,
+                       key,
+                       generation = m_Generation.load(),
+                       pixbuf     = m_Pixbuf,
+                       w          = m_Width,
+                       h          = m_Height,
+                       filter     = m_Filter]() {
+        if (generation != m_Generation)
+            return;
+
+        Tile tile{ key, nullptr, generation };
+
+        // The tile scrolled out of view before it was started, it still needs to be
+        // removed from m_Pending
+        if (is_visible(key))
+            tile.pixbuf = create_tile(key, pixbuf, w, h, filter);
+
+        m_LoadedQueue.push(std::move(tile));
+        m_SignalTileLoaded();
+    });
+}
+
+bool TileCache::is_visible(const TileKey& key)
+{
+    std::scoped_lock lock{ m_VisibleMutex };
+    return key.first >= m_VisibleStart.first && key.first <= m_VisibleEnd.first &&
+           key.second >= m_VisibleStart.second && key.second <= m_VisibleEnd.second;
+}
+
+void TileCache::on_tile_loaded()
+{
+    Tile tile;
+    bool ready{ false };
+
+    while (m_LoadedQueue.pop(tile))
+    {
+        if (tile.generation != m_Generation)
+            continue;
+
+        m_Pending.erase(tile.key);
+
+        if (tile.pixbuf && is_visible(tile.key))
+        {
+            m_Tiles[tile.key] = tile.pixbuf;
+            ready             = true;
+        }
+    }
+
+    if (ready)
+        m_SignalTilesReady();
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "threadpool.h"
+#include "tsqueue.h"
+#include "util.h"
+
+#include <gtkmm.h>
+#include <map>
+#include <set>
+
+namespace AhoViewer
+{
+    // Renders a scaled pixbuf in tiles so only the visible part of it is scaled and
+    // kept in memory.  Tiles are scaled by worker threads, and are evicted once they
+    // are no longer near the visible area
+    class TileCache
+    {
+        // column, row
+        using TileKey = std::pair<int, int>;
+
+        struct Tile
+        {
+            TileKey key;
+            Glib::RefPtr<Gdk::Pixbuf> pixbuf;
+            unsigned int generation;
+        };
+
+    public:
+        TileCache();
+        ~TileCache();
+
+        // Clears the tiles if the pixbuf, the size it is scaled to or the filter have changed
+        void set_source(const Glib::RefPtr<Gdk::Pixbuf>& pixbuf,
+                        const int w,
+                        const int h,
+                        const ScalingFilter filter);
+        void clear();
+        bool empty() const { return !m_Pixbuf; }
+
+        // Draws the tiles that intersect the clip region of cr.  Tiles that are not ready yet
+        // are queued, and drawn with a fast filter until they are.
+        // viewport is the visible area of the scaled image, tiles far from it are evicted
+        void draw(const Cairo::RefPtr<Cairo::Context>& cr, const Gdk::Rectangle& viewport);
+
+        // Emitted when tiles have finished scaling and need to be drawn
+        sigc::signal<void> signal_tiles_ready() const { return m_SignalTilesReady; }
+
+        static constexpr int TileSize{ 256 };
+
+    private:
+        // Fast nearest neighbour tile that is drawn until the filtered one is ready
+        Glib::RefPtr<Gdk::Pixbuf> create_fast_tile(const TileKey& key) const;
+        // Called by the worker threads, the source is passed in since it can be changed
+        // while they are running
+        static Glib::RefPtr<Gdk::Pixbuf> create_tile(const TileKey& key,
+                                                     const Glib::RefPtr<Gdk::Pixbuf>& pixbuf,
+                                                     const int width,
+                                                     const int height,
+                                                     const ScalingFilter filter);
+        void queue_tile(const TileKey& key);
+        bool is_visible(const TileKey& key);
+        void on_tile_loaded();
+
+        Glib::RefPtr<Gdk::Pixbuf> m_Pixbuf;
+        int m_Width{ 0 }, m_Height{ 0 };
+        ScalingFilter m_Filter{ ScalingFilter::BILINEAR };
+
+        std::map<TileKey, Glib::RefPtr<Gdk::Pixbuf>> m_Tiles;
+        // Tiles that have been queued but haven't finished scaling
+        std::set<TileKey> m_Pending;
+        TSQueue<Tile> m_LoadedQueue;
+        // Incremented when the tiles are cleared, so tiles that were being scaled
+        // for the old source are discarded
+        std::atomic<unsigned int> m_Generation{ 0 };
+
+        // Columns and rows of the visible and last drawn tiles, including a margin
+        // of one tile around them.  Queued tiles outside of this are skipped
+        std::mutex m_VisibleMutex;
+        TileKey m_VisibleStart{ 0, 0 }, m_VisibleEnd{ -1, -1 };
+
+        ThreadPool m_ThreadPool;
+        Glib::Dispatcher m_SignalTileLoaded;
+        sigc::signal<void> m_SignalTilesReady;
+    };
+}
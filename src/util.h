@@ -15,6 +15,14 @@ namespace AhoViewer
         FIT_HEIGHT = 'H',
         MANUAL     = 'M',
     };
+    // Filters used by Resampler, GDK_BILINEAR uses GdkPixbuf's own scaling
+    enum class ScalingFilter
+    {
+        GDK_BILINEAR = 0,
+        BILINEAR     = 1,
+        LANCZOS      = 2,
+        AREA         = 3,
+    };
     struct Note
     {
         Note(std::string body, const int w, const int h, const int x, const int y)